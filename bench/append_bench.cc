@@ -0,0 +1,140 @@
+/**
+ * @file bench/append_bench.cc
+ * @brief Inserting increasing keys into linked_map.
+ *
+ * linked_map checks the rightmost key before it descends, so a key greater
+ * than every key present is appended with one comparison. It is compared
+ * with std::map, which descends for every insert unless given end() as a
+ * hint, on three streams of distinct int64_t keys:
+ *
+ *   increasing   0, 1, 2, ...
+ *   late         increasing, but 1% of the keys arrive up to 1000 positions late
+ *   jitter       increasing, but 1% of the keys trade places with a key up to
+ *                1000 positions earlier, which then arrives early
+ *   random       shuffled
+ *
+ * Besides the time, every run counts comparator calls per insert.
+ */
+
+#include <map>
+
+#include "container/linked_map.h"
+
+#include "bench.h"
+
+using namespace ant;
+using namespace ant::bench;
+
+namespace {
+
+size_t compares;
+
+struct counting_less {
+	bool operator()(int64_t x, int64_t y) const
+	{
+		++compares;
+		return x < y;
+	}
+};
+
+std::vector<int64_t> make_stream(const std::string& kind, size_t n)
+{
+	std::vector<int64_t> keys(n);
+	for (size_t i = 0; i != n; ++i) {
+		keys[i] = static_cast<int64_t>(i);
+	}
+	if (kind == "late") {
+		std::vector<std::pair<uint64_t, int64_t> > arrivals(n);
+		for (size_t i = 0; i != n; ++i) {
+			uint64_t h = mix64(i);
+			uint64_t at = i * 2;
+			if (h % 100 == 0) {
+				at += ((h >> 32) % 1000 + 1) * 2 + 1;
+			}
+			arrivals[i] = std::make_pair(at, keys[i]);
+		}
+		std::sort(arrivals.begin(), arrivals.end());
+		for (size_t i = 0; i != n; ++i) {
+			keys[i] = arrivals[i].second;
+		}
+	} else if (kind == "jitter") {
+		for (size_t i = 0; i != n; ++i) {
+			uint64_t h = mix64(i);
+			if (h % 100 == 0) {
+				size_t back = (h >> 32) % 1000 + 1;
+				if (back <= i) {
+					std::swap(keys[i], keys[i - back]);
+				}
+			}
+		}
+	} else if (kind == "random") {
+		shuffle(keys);
+	}
+	return keys;
+}
+
+template<typename _Map>
+void insert_all(_Map& m, const std::vector<int64_t>& keys)
+{
+	for (size_t i = 0; i != keys.size(); ++i) {
+		m.insert(typename _Map::value_type(keys[i], 1));
+	}
+}
+
+template<typename _Map>
+void insert_all_hinted(_Map& m, const std::vector<int64_t>& keys)
+{
+	for (size_t i = 0; i != keys.size(); ++i) {
+		m.insert(m.end(), typename _Map::value_type(keys[i], 1));
+	}
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	runner r(argc, argv);
+	const char* kinds[] = { "increasing", "late", "jitter", "random" };
+	for (size_t n = 1000; n <= r.max_size(); n *= 10) {
+		for (size_t k = 0; k != sizeof(kinds) / sizeof(kinds[0]); ++k) {
+			const std::vector<int64_t> keys = make_stream(kinds[k], n);
+			const std::string suffix = "/" + std::string(kinds[k]) + "/" + std::to_string(n);
+
+			r.run("insert/linked_map" + suffix, n, [&](timer& t) {
+				linked_map<int64_t, int64_t, counting_less> m;
+				compares = 0;
+				t.start();
+				insert_all(m, keys);
+				t.stop();
+				t.count("compares", compares);
+			});
+			r.run("operator[]/linked_map" + suffix, n, [&](timer& t) {
+				linked_map<int64_t, int64_t, counting_less> m;
+				compares = 0;
+				t.start();
+				for (size_t i = 0; i != n; ++i) {
+					m[keys[i]] = 1;
+				}
+				t.stop();
+				t.count("compares", compares);
+			});
+			r.run("insert/std::map" + suffix, n, [&](timer& t) {
+				std::map<int64_t, int64_t, counting_less> m;
+				compares = 0;
+				t.start();
+				insert_all(m, keys);
+				t.stop();
+				t.count("compares", compares);
+			});
+			r.run("insert_end_hint/std::map" + suffix, n, [&](timer& t) {
+				std::map<int64_t, int64_t, counting_less> m;
+				compares = 0;
+				t.start();
+				insert_all_hinted(m, keys);
+				t.stop();
+				t.count("compares", compares);
+			});
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file bench/arena_bench.cc
+ * @brief Building and destroying linked containers on a monotonic arena.
+ *
+ * A linked container whose allocator is an arena (a polymorphic_allocator
+ * over a monotonic_buffer_resource, or any allocator marked with
+ * is_arena_allocator) and whose elements are trivially destructible is
+ * destroyed without visiting its nodes. The teardown runs time that
+ * destruction for the same n random int64_t keys held by:
+ *
+ *   std::allocator   per-node free
+ *   pool             polymorphic_allocator over an unsynchronized_pool_resource,
+ *                    not an arena, so the nodes are still walked
+ *   monotonic        polymorphic_allocator over a monotonic_buffer_resource,
+ *                    the fast teardown, plus releasing the resource
+ *
+ * std::pmr::map on the same monotonic resource walks its nodes on
+ * destruction and is there for reference. The build runs time inserting the
+ * keys. lru_set is built with room for every key, so nothing is evicted;
+ * with evictions a monotonic resource keeps the memory of every evicted key
+ * until it is released.
+ */
+
+#include <map>
+#include <memory_resource>
+#include <optional>
+
+#include "container/linked_map.h"
+#include "container/lru_set.h"
+
+#include "bench.h"
+
+using namespace ant;
+using namespace ant::bench;
+
+namespace {
+
+template<typename _Map>
+void fill(_Map& m, const std::vector<int64_t>& keys)
+{
+	for (size_t i = 0; i != keys.size(); ++i) {
+		m.emplace(keys[i], keys[i]);
+	}
+}
+
+template<typename _Set>
+void fill_lru(_Set& s, const std::vector<int64_t>& keys)
+{
+	for (size_t i = 0; i != keys.size(); ++i) {
+		s.insert(keys[i]);
+	}
+}
+
+// Times building the container in c, then its destruction.
+template<typename _Container, typename _Fill, typename _Release>
+void run_pair(runner& r, const std::string& name, size_t n, std::optional<_Container>& c,
+			  _Fill fill_it, _Release release)
+{
+	r.run("build/" + name, n, [&](timer& t) {
+		t.start();
+		fill_it();
+		t.stop();
+		c.reset();
+		release();
+	});
+	r.run("teardown/" + name, n, [&](timer& t) {
+		fill_it();
+		t.start();
+		c.reset();
+		release();
+		t.stop();
+	});
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	runner r(argc, argv);
+	for (size_t n = 10000; n <= r.max_size(); n *= 10) {
+		std::vector<int64_t> keys(n);
+		for (size_t i = 0; i != n; ++i) {
+			keys[i] = static_cast<int64_t>(mix64(i));
+		}
+		const std::string size = "/" + std::to_string(n);
+		auto nothing = [] {};
+
+		{
+			std::optional<linked_map<int64_t, int64_t> > m;
+			run_pair(r, "linked_map/std::allocator" + size, n, m, [&] {
+				m.emplace();
+				fill(*m, keys);
+			}, nothing);
+		}
+		{
+			std::optional<std::pmr::unsynchronized_pool_resource> pool;
+			std::optional<pmr::linked_map<int64_t, int64_t> > m;
+			run_pair(r, "linked_map/pool" + size, n, m, [&] {
+				pool.emplace();
+				m.emplace(&*pool);
+				fill(*m, keys);
+			}, [&] {
+				pool.reset();
+			});
+		}
+		{
+			std::pmr::monotonic_buffer_resource mono;
+			std::optional<pmr::linked_map<int64_t, int64_t> > m;
+			run_pair(r, "linked_map/monotonic" + size, n, m, [&] {
+				m.emplace(&mono);
+				fill(*m, keys);
+			}, [&] {
+				mono.release();
+			});
+		}
+		{
+			std::pmr::monotonic_buffer_resource mono;
+			std::optional<std::pmr::map<int64_t, int64_t> > m;
+			run_pair(r, "std::pmr::map/monotonic" + size, n, m, [&] {
+				m.emplace(&mono);
+				fill(*m, keys);
+			}, [&] {
+				mono.release();
+			});
+		}
+		{
+			std::optional<lru_set<int64_t> > s;
+			run_pair(r, "lru_set/std::allocator" + size, n, s, [&] {
+				s.emplace(n);
+				fill_lru(*s, keys);
+			}, nothing);
+		}
+		{
+			std::pmr::monotonic_buffer_resource mono;
+			std::optional<pmr::lru_set<int64_t> > s;
+			run_pair(r, "lru_set/monotonic" + size, n, s, [&] {
+				s.emplace(n, &mono);
+				fill_lru(*s, keys);
+			}, [&] {
+				mono.release();
+			});
+		}
+	}
+	return 0;
+}
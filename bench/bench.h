@@ -0,0 +1,284 @@
+/**
+ * @file bench/bench.h
+ * @brief A small timing harness shared by the container benchmarks.
+ */
+
+#ifndef LIBANT_BENCH_BENCH_H_
+#define LIBANT_BENCH_BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <time.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ant {
+namespace bench {
+
+/**
+ * @brief Measures the part of a benchmark between start() and stop(), in wall and CPU time.
+ */
+class timer {
+public:
+	timer() : wall_(0), cpu_(0), counterName_(0), counter_(0)
+	{
+	}
+
+	void start()
+	{
+		cpuStart_ = cpu_now();
+		wallStart_ = std::chrono::steady_clock::now();
+	}
+
+	void stop()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		cpu_ += cpu_now() - cpuStart_;
+		wall_ += std::chrono::duration<double, std::nano>(now - wallStart_).count();
+	}
+
+	double wall_ns() const
+	{
+		return wall_;
+	}
+
+	double cpu_ns() const
+	{
+		return cpu_;
+	}
+
+	/**
+	 * @brief Reports a count besides the time, such as comparisons; it is divided by the operations too.
+	 */
+	void count(const char* name, double value)
+	{
+		counterName_ = name;
+		counter_ = value;
+	}
+
+	const char* counter_name() const
+	{
+		return counterName_;
+	}
+
+	double counter() const
+	{
+		return counter_;
+	}
+
+private:
+	// CPU time of the whole process, so that worker threads are counted too
+	static double cpu_now()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+		return ts.tv_sec * 1e9 + ts.tv_nsec;
+	}
+
+private:
+	std::chrono::steady_clock::time_point	wallStart_;
+	double									cpuStart_;
+	double									wall_;
+	double									cpu_;
+	const char*								counterName_;
+	double									counter_;
+};
+
+/**
+ * @brief Keeps the compiler from discarding a computed value.
+ */
+template<typename _Tp>
+inline void keep(const _Tp& v)
+{
+	asm volatile("" : : "r"(&v) : "memory");
+}
+
+/**
+ * @brief splitmix64: a bijection on 64-bit integers, so distinct inputs give distinct keys.
+ */
+inline uint64_t mix64(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/**
+ * @brief Shuffles v in place with a fixed seed, so every run sees the same order.
+ */
+template<typename _Tp>
+void shuffle(std::vector<_Tp>& v, uint64_t seed = 1)
+{
+	for (size_t i = v.size(); i > 1; --i) {
+		size_t j = mix64(seed + i) % i;
+		std::swap(v[i - 1], v[j]);
+	}
+}
+
+/**
+ * @brief Runs benchmarks, prints one line per result and optionally writes them as JSON.
+ *
+ * Command line options:
+ *   --filter=TEXT     only run benchmarks whose name contains TEXT
+ *   --max-size=N      skip element counts above N (1M unless the benchmark says otherwise)
+ *   --min-time=SEC    repeat each benchmark for at least SEC seconds (default 0.2)
+ *   --json=FILE       also write the results to FILE
+ *
+ * A benchmark is repeated until it has run for the minimum time, at least
+ * three times, and the fastest repetition is reported, per operation. Time
+ * spent outside start() and stop(), setting up, counts as well once it
+ * reaches ten times the minimum, so a cheap step behind an expensive setup
+ * isn't repeated a thousand times. The
+ * JSON uses Google Benchmark's layout, so its tools/compare.py can diff two
+ * runs.
+ */
+class runner {
+public:
+	/**
+	 * @param defaultMaxSize largest element count run unless --max-size says otherwise
+	 */
+	runner(int argc, char** argv, size_t defaultMaxSize = 1000000) : maxSize_(defaultMaxSize), minTime_(0.2)
+	{
+		for (int i = 1; i != argc; ++i) {
+			const char* arg = argv[i];
+			if (strncmp(arg, "--filter=", 9) == 0) {
+				filter_ = arg + 9;
+			} else if (strncmp(arg, "--max-size=", 11) == 0) {
+				maxSize_ = strtoull(arg + 11, 0, 10);
+			} else if (strncmp(arg, "--min-time=", 11) == 0) {
+				minTime_ = strtod(arg + 11, 0);
+			} else if (strncmp(arg, "--json=", 7) == 0) {
+				json_ = arg + 7;
+			} else {
+				fprintf(stderr, "unknown option %s\n", arg);
+				exit(2);
+			}
+		}
+		printf("%-56s %14s %14s %10s\n", "benchmark", "ns/op (wall)", "ns/op (cpu)", "reps");
+	}
+
+	~runner()
+	{
+		if (!json_.empty()) {
+			write_json();
+		}
+	}
+
+	size_t max_size() const
+	{
+		return maxSize_;
+	}
+
+	bool enabled(const std::string& name) const
+	{
+		return filter_.empty() || name.find(filter_) != std::string::npos;
+	}
+
+	/**
+	 * @brief Times f(timer&), which performs ops operations, and records the fastest repetition.
+	 */
+	template<typename _Function>
+	void run(const std::string& name, size_t ops, _Function f)
+	{
+		if (!enabled(name)) {
+			return;
+		}
+		result r;
+		r.name = name;
+		r.ops = ops;
+		r.reps = 0;
+		r.wall = 0;
+		r.cpu = 0;
+		r.counterName = 0;
+		r.counter = 0;
+		double total = 0;
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		double spent = 0;
+		while (r.reps < 3 || (total < minTime_ * 1e9 && spent < minTime_ * 1e10 && r.reps < 1000)) {
+			timer t;
+			f(t);
+			total += t.wall_ns();
+			spent = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+			if (r.reps == 0 || t.wall_ns() < r.wall) {
+				r.wall = t.wall_ns();
+				r.cpu = t.cpu_ns();
+				r.counterName = t.counter_name();
+				r.counter = t.counter() / ops;
+			}
+			++r.reps;
+		}
+		r.wall /= ops;
+		r.cpu /= ops;
+		printf("%-56s %14.2f %14.2f %10u", name.c_str(), r.wall, r.cpu, r.reps);
+		if (r.counterName) {
+			printf("   %s=%.2f", r.counterName, r.counter);
+		}
+		printf("\n");
+		fflush(stdout);
+		results_.push_back(r);
+	}
+
+private:
+	struct result {
+		std::string	name;
+		size_t		ops;
+		unsigned	reps;
+		double		wall;	// ns per operation
+		double		cpu;
+		const char*	counterName;	// optional per operation count, see timer::count()
+		double		counter;
+	};
+
+	void write_json() const
+	{
+		FILE* fp = fopen(json_.c_str(), "w");
+		if (!fp) {
+			perror(json_.c_str());
+			return;
+		}
+		char date[64];
+		time_t now = time(0);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+		fprintf(fp, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"num_cpus\": %u,\n"
+					"    \"library_build_type\": \"%s\"\n  },\n  \"benchmarks\": [\n",
+				date, std::thread::hardware_concurrency(),
+#ifdef NDEBUG
+				"release"
+#else
+				"debug"
+#endif
+				);
+		for (size_t i = 0; i != results_.size(); ++i) {
+			const result& r = results_[i];
+			fprintf(fp, "    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n      \"run_type\": \"iteration\",\n"
+						"      \"repetitions\": %u,\n      \"iterations\": %zu,\n      \"real_time\": %.4f,\n"
+						"      \"cpu_time\": %.4f,\n      \"time_unit\": \"ns\",\n      \"items_per_second\": %.1f",
+					r.name.c_str(), r.name.c_str(), r.reps, r.ops, r.wall, r.cpu, 1e9 / r.wall);
+			if (r.counterName) {
+				fprintf(fp, ",\n      \"%s\": %.4f", r.counterName, r.counter);
+			}
+			fprintf(fp, "\n    }%s\n", i + 1 == results_.size() ? "" : ",");
+		}
+		fprintf(fp, "  ]\n}\n");
+		fclose(fp);
+	}
+
+private:
+	std::string			filter_;
+	std::string			json_;
+	size_t				maxSize_;
+	double				minTime_;
+	std::vector<result>	results_;
+};
+
+}
+}
+
+#endif // LIBANT_BENCH_BENCH_H_
@@ -0,0 +1,104 @@
+/**
+ * @file bench/compare_bench.cc
+ * @brief Three-way against two-way key comparison in _Rb_tree.
+ *
+ * Keys share a 48 byte prefix, so every comparison scans it before it can
+ * decide. The default std::less of std::string and small_string descends with
+ * one compare() per level; the two_way_less baseline is a plain comparison
+ * object without compare(), which costs up to two operator< calls per level.
+ */
+
+#include <string>
+
+#include "container/linked_map.h"
+#include "container/small_string.h"
+
+#include "bench.h"
+
+using namespace ant;
+using namespace ant::bench;
+
+namespace {
+
+template<typename _Tp>
+struct two_way_less {
+	bool operator()(const _Tp& x, const _Tp& y) const
+	{
+		return x < y;
+	}
+};
+
+template<typename _Key>
+std::vector<_Key> make_keys(size_t n)
+{
+	std::vector<_Key> keys;
+	for (size_t i = 0; i != n; ++i) {
+		char buf[96];
+		snprintf(buf, sizeof(buf), "tenant/region-eu-west/bucket-0000000000000000/%016llx",
+				 static_cast<unsigned long long>(mix64(i)));
+		keys.push_back(_Key(std::string(buf)));
+	}
+	return keys;
+}
+
+template<typename _Map, typename _Key>
+void run_map(runner& r, const std::string& name, const std::vector<_Key>& keys, const std::vector<_Key>& shuffled)
+{
+	const size_t n = keys.size();
+	const std::string suffix = "/" + name + "/" + std::to_string(n);
+	_Map full;
+	for (size_t i = 0; i != n; ++i) {
+		full.insert(typename _Map::value_type(keys[i], 1));
+	}
+
+	r.run("insert" + suffix, n, [&](timer& t) {
+		_Map m;
+		t.start();
+		for (size_t i = 0; i != n; ++i) {
+			m.insert(typename _Map::value_type(keys[i], 1));
+		}
+		t.stop();
+	});
+
+	r.run("find" + suffix, n, [&](timer& t) {
+		int64_t sum = 0;
+		t.start();
+		for (size_t i = 0; i != n; ++i) {
+			sum += full.find(shuffled[i])->second;
+		}
+		t.stop();
+		keep(sum);
+	});
+
+	r.run("insert_existing" + suffix, n, [&](timer& t) {
+		size_t added = 0;
+		t.start();
+		for (size_t i = 0; i != n; ++i) {
+			added += full.insert(typename _Map::value_type(shuffled[i], 1)).second;
+		}
+		t.stop();
+		keep(added);
+	});
+}
+
+template<typename _Key>
+void run_key(runner& r, const std::string& keyName)
+{
+	for (size_t n = 1000; n <= r.max_size(); n *= 10) {
+		std::vector<_Key> keys = make_keys<_Key>(n);
+		std::vector<_Key> shuffled(keys);
+		shuffle(shuffled);
+		run_map<linked_map<_Key, int64_t> >(r, keyName + "/three_way", keys, shuffled);
+		run_map<linked_map<_Key, int64_t, two_way_less<_Key> > >(r, keyName + "/two_way", keys, shuffled);
+	}
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	runner r(argc, argv);
+	run_key<std::string>(r, "string");
+	run_key<small_string>(r, "small_string");
+	return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file bench/concurrent_bench.cc
+ * @brief Read scaling and write cost of concurrent_linked_map.
+ *
+ * read/...: every thread looks up random keys of a 100K element
+ * map<small_string, int64_t>; the result is the wall time per lookup over all
+ * threads, so flat numbers mean linear scaling. The baseline is a linked_map
+ * behind std::shared_mutex, with a shared lock taken per lookup.
+ *
+ * write/...: the cost of one assign() at different map sizes, which copies
+ * the whole map.
+ */
+
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "container/concurrent_linked_map.h"
+#include "container/linked_map.h"
+#include "container/small_string.h"
+
+#include "bench.h"
+
+using namespace ant;
+using namespace ant::bench;
+
+namespace {
+
+typedef linked_map<small_string, int64_t> map_type;
+
+small_string make_key(uint64_t i)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "route:%016llx", static_cast<unsigned long long>(mix64(i)));
+	return small_string(std::string(buf));
+}
+
+class shared_mutex_map {
+public:
+	explicit shared_mutex_map(const map_type& m) : map_(m)
+	{
+	}
+
+	bool find(const small_string& key, int64_t& value) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mtx_);
+		map_type::const_iterator it = map_.find(key);
+		if (it == map_.end()) {
+			return false;
+		}
+		value = it->second;
+		return true;
+	}
+
+private:
+	mutable std::shared_mutex	mtx_;
+	map_type					map_;
+};
+
+/**
+ * @brief Runs lookups of random keys on threads threads, perThread lookups each, between t.start() and t.stop().
+ */
+template<typename _Map>
+void read_threads(timer& t, const _Map& m, const std::vector<small_string>& keys, unsigned threads, size_t perThread)
+{
+	std::atomic<unsigned> ready(0);
+	std::atomic<bool> go(false);
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i != threads; ++i) {
+		workers.emplace_back([&, i] {
+			int64_t sum = 0;
+			int64_t v;
+			uint64_t x = i + 1;
+			ready.fetch_add(1);
+			while (!go.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			for (size_t n = 0; n != perThread; ++n) {
+				x = mix64(x);
+				if (m.find(keys[x % keys.size()], v)) {
+					sum += v;
+				}
+			}
+			keep(sum);
+		});
+	}
+	while (ready.load() != threads) {
+		std::this_thread::yield();
+	}
+	t.start();
+	go.store(true, std::memory_order_release);
+	for (auto& w : workers) {
+		w.join();
+	}
+	t.stop();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	runner r(argc, argv);
+
+	const size_t elements = 100000;
+	const size_t perThread = 200000;
+	std::vector<small_string> keys;
+	map_type base;
+	for (size_t i = 0; i != elements; ++i) {
+		keys.push_back(make_key(i));
+		base.insert(map_type::value_type(keys.back(), int64_t(i)));
+	}
+	concurrent_linked_map<small_string, int64_t> cmap(base);
+	shared_mutex_map smap(base);
+
+	for (unsigned threads = 1; threads <= 64; threads *= 2) {
+		r.run("read/concurrent_linked_map/threads:" + std::to_string(threads), threads * perThread,
+				[&](timer& t) { read_threads(t, cmap, keys, threads, perThread); });
+		r.run("read/shared_mutex_linked_map/threads:" + std::to_string(threads), threads * perThread,
+				[&](timer& t) { read_threads(t, smap, keys, threads, perThread); });
+	}
+
+	for (size_t n = 1000; n <= r.max_size(); n *= 10) {
+		map_type m;
+		for (size_t i = 0; i != n; ++i) {
+			m.insert(map_type::value_type(make_key(i), int64_t(i)));
+		}
+		concurrent_linked_map<small_string, int64_t> c(m);
+		small_string key = make_key(n / 2);
+		const size_t writes = n >= 100000 ? 4 : 64;
+		r.run("write/assign/" + std::to_string(n), writes, [&](timer& t) {
+			t.start();
+			for (size_t i = 0; i != writes; ++i) {
+				c.assign(key, int64_t(i));
+			}
+			t.stop();
+		});
+		r.run("write/update_64_keys/" + std::to_string(n), writes, [&](timer& t) {
+			t.start();
+			for (size_t i = 0; i != writes; ++i) {
+				c.update([&](map_type& w) {
+					for (size_t k = 0; k != 64; ++k) {
+						w[make_key(k)] = int64_t(i);
+					}
+				});
+			}
+			t.stop();
+		});
+	}
+	return 0;
+}
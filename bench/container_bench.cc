@@ -0,0 +1,233 @@
+/**
+ * @file bench/container_bench.cc
+ * @brief Compares linked_map and linked_set with std::map, std::set and std::unordered_map.
+ *
+ * Every operation is timed on int64_t, std::string and small_string keys at
+ * 1K to 10M elements (--max-size, 1M by default). String keys are 20
+ * characters, too long for either type's inline buffer.
+ *
+ * memory_usage/... times memory_usage() of linked_map, linked_set and an
+ * lru_set holding every key, and reports the bytes per element it counts.
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "container/linked_map.h"
+#include "container/linked_set.h"
+#include "container/lru_set.h"
+#include "container/small_string.h"
+
+#include "bench.h"
+
+using namespace ant;
+using namespace ant::bench;
+
+namespace {
+
+template<typename _Key>
+_Key make_key(uint64_t x);
+
+template<>
+int64_t make_key<int64_t>(uint64_t x)
+{
+	return static_cast<int64_t>(x);
+}
+
+template<>
+std::string make_key<std::string>(uint64_t x)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "key:%016llx", static_cast<unsigned long long>(x));
+	return buf;
+}
+
+template<>
+small_string make_key<small_string>(uint64_t x)
+{
+	return small_string(make_key<std::string>(x));
+}
+
+template<typename _Key>
+std::vector<_Key> make_keys(size_t n)
+{
+	std::vector<_Key> keys;
+	keys.reserve(n);
+	for (size_t i = 0; i != n; ++i) {
+		keys.push_back(make_key<_Key>(mix64(i)));
+	}
+	return keys;
+}
+
+// Map and set elements are built and read the same way through these.
+
+template<typename _Key>
+std::pair<const _Key, int64_t> element(const _Key& key, std::map<_Key, int64_t>*)
+{
+	return std::pair<const _Key, int64_t>(key, 1);
+}
+
+template<typename _Key>
+std::pair<const _Key, int64_t> element(const _Key& key, std::unordered_map<_Key, int64_t>*)
+{
+	return std::pair<const _Key, int64_t>(key, 1);
+}
+
+template<typename _Key>
+std::pair<const _Key, int64_t> element(const _Key& key, linked_map<_Key, int64_t>*)
+{
+	return std::pair<const _Key, int64_t>(key, 1);
+}
+
+template<typename _Key, typename _Container>
+const _Key& element(const _Key& key, _Container*)
+{
+	return key;
+}
+
+template<typename _Key, typename _Tp>
+int64_t value_of(const std::pair<const _Key, _Tp>& v)
+{
+	return v.second;
+}
+
+inline int64_t value_of(int64_t key)
+{
+	return key;
+}
+
+template<typename _Key>
+int64_t value_of(const _Key& key)
+{
+	return key.size();
+}
+
+template<typename _Container, typename _Key>
+void run_common(runner& r, const std::string& container, const std::string& keyName,
+				const std::vector<_Key>& keys, const std::vector<_Key>& shuffled)
+{
+	const size_t n = keys.size();
+	const std::string suffix = "/" + container + "/" + keyName + "/" + std::to_string(n);
+
+	_Container full;
+	for (size_t i = 0; i != n; ++i) {
+		full.insert(element(keys[i], static_cast<_Container*>(0)));
+	}
+
+	r.run("insert" + suffix, n, [&](timer& t) {
+		_Container c;
+		t.start();
+		for (size_t i = 0; i != n; ++i) {
+			c.insert(element(keys[i], static_cast<_Container*>(0)));
+		}
+		t.stop();
+	});
+
+	r.run("find" + suffix, n, [&](timer& t) {
+		int64_t sum = 0;
+		t.start();
+		for (size_t i = 0; i != n; ++i) {
+			sum += value_of(*full.find(shuffled[i]));
+		}
+		t.stop();
+		keep(sum);
+	});
+
+	r.run("erase" + suffix, n, [&](timer& t) {
+		_Container c(full);
+		t.start();
+		for (size_t i = 0; i != n; ++i) {
+			c.erase(shuffled[i]);
+		}
+		t.stop();
+	});
+
+	r.run("iterate" + suffix, n, [&](timer& t) {
+		int64_t sum = 0;
+		t.start();
+		for (typename _Container::const_iterator it = full.begin(); it != full.end(); ++it) {
+			sum += value_of(*it);
+		}
+		t.stop();
+		keep(sum);
+	});
+
+	r.run("copy" + suffix, n, [&](timer& t) {
+		t.start();
+		_Container* c = new _Container(full);
+		t.stop();
+		keep(c);
+		delete c;
+	});
+}
+
+template<typename _Container>
+void run_memory(runner& r, const std::string& suffix, const _Container& full, size_t n)
+{
+	r.run("memory_usage" + suffix, n, [&](timer& t) {
+		t.start();
+		container_memory_usage u = full.memory_usage();
+		t.stop();
+		t.count("bytes", u.total_bytes());
+	});
+}
+
+template<typename _Container, typename _Key>
+void run_link(runner& r, const std::string& container, const std::string& keyName, const std::vector<_Key>& keys)
+{
+	const size_t n = keys.size();
+	_Container full;
+	for (size_t i = 0; i != n; ++i) {
+		full.insert(element(keys[i], static_cast<_Container*>(0)));
+	}
+	r.run("iterate_link/" + container + "/" + keyName + "/" + std::to_string(n), n, [&](timer& t) {
+		int64_t sum = 0;
+		t.start();
+		for (typename _Container::const_link_iterator it = full.link_begin(); it != full.link_end(); ++it) {
+			sum += value_of(*it);
+		}
+		t.stop();
+		keep(sum);
+	});
+	run_memory(r, "/" + container + "/" + keyName + "/" + std::to_string(n), full, n);
+}
+
+template<typename _Key>
+void run_key(runner& r, const std::string& keyName)
+{
+	for (size_t n = 1000; n <= r.max_size(); n *= 10) {
+		std::vector<_Key> keys = make_keys<_Key>(n);
+		std::vector<_Key> shuffled(keys);
+		shuffle(shuffled);
+
+		run_common<linked_map<_Key, int64_t> >(r, "linked_map", keyName, keys, shuffled);
+		run_link<linked_map<_Key, int64_t> >(r, "linked_map", keyName, keys);
+		run_common<std::map<_Key, int64_t> >(r, "std::map", keyName, keys, shuffled);
+		run_common<std::unordered_map<_Key, int64_t> >(r, "std::unordered_map", keyName, keys, shuffled);
+
+		run_common<linked_set<_Key> >(r, "linked_set", keyName, keys, shuffled);
+		run_link<linked_set<_Key> >(r, "linked_set", keyName, keys);
+		run_common<std::set<_Key> >(r, "std::set", keyName, keys, shuffled);
+		run_common<std::unordered_set<_Key> >(r, "std::unordered_set", keyName, keys, shuffled);
+
+		lru_set<_Key> lru(n);
+		for (size_t i = 0; i != n; ++i) {
+			lru.insert(keys[i]);
+		}
+		run_memory(r, "/lru_set/" + keyName + "/" + std::to_string(n), lru, n);
+	}
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	runner r(argc, argv);
+	run_key<int64_t>(r, "int64");
+	run_key<std::string>(r, "string");
+	run_key<small_string>(r, "small_string");
+	return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file bench/hugepage_bench.cc
+ * @brief Lookup latency of large linked_maps on huge pages and on regular pages.
+ *
+ * A linked_map<uint64_t, uint64_t> of n random keys is built with:
+ *
+ *   std::allocator/4k   malloc, with transparent huge pages turned off for
+ *                       the process (PR_SET_THP_DISABLE) while it is built
+ *   std::allocator      malloc, under the system's transparent huge page policy
+ *   hugepage_allocator  a hugepage_arena, MAP_HUGETLB when huge pages are
+ *                       reserved, MADV_HUGEPAGE otherwise
+ *   hugepage_allocator/4k
+ *                       a hugepage_arena in regular mode with transparent huge
+ *                       pages turned off: the arena's packing without huge
+ *                       pages, which tells its two effects apart
+ *
+ * find/... looks up a shuffled list of present keys; the lookups are
+ * independent, so the CPU overlaps their misses. find_chain/... takes the
+ * next key from the value found, so every lookup waits for the one before
+ * and the time is the latency of a lookup. Before the runs of a map, a line
+ * starting with # reports how much of the memory the build added is on huge
+ * pages, from /proc/self/smaps_rollup, and the page mode the arena ended up
+ * with.
+ */
+
+#include <malloc.h>
+#include <sys/prctl.h>
+
+#include <fstream>
+
+#include "container/hugepage_allocator.h"
+#include "container/linked_map.h"
+
+#include "bench.h"
+
+using namespace ant;
+using namespace ant::bench;
+
+namespace {
+
+const size_t lookups = 1000000;
+
+// Anonymous and huge page backed anonymous memory of the process, in bytes.
+void anon_bytes(size_t& anon, size_t& huge)
+{
+	anon = 0;
+	huge = 0;
+	std::ifstream in("/proc/self/smaps_rollup");
+	in.ignore(1024, '\n');	// the address range
+	std::string name;
+	size_t kb;
+	while (in >> name >> kb) {
+		if (name == "Anonymous:") {
+			anon = kb * 1024;
+		} else if (name == "AnonHugePages:") {
+			huge = kb * 1024;
+		}
+		in.ignore(256, '\n');
+	}
+}
+
+const char* mode_name(hugepage_arena::page_mode mode)
+{
+	switch (mode) {
+	case hugepage_arena::hugetlb:
+		return "hugetlb";
+	case hugepage_arena::transparent:
+		return "transparent";
+	default:
+		return "regular";
+	}
+}
+
+// Builds m with keys[i] -> index of the key to look up after keys[i].
+template<typename _Map>
+void build(_Map& m, const std::vector<uint64_t>& keys, const std::string& name)
+{
+	size_t anon0, huge0;
+	anon_bytes(anon0, huge0);
+	std::vector<size_t> next(keys.size());
+	for (size_t i = 0; i != next.size(); ++i) {
+		next[i] = i;
+	}
+	shuffle(next, 7);
+	for (size_t i = 0; i != keys.size(); ++i) {
+		m.emplace(keys[i], next[i]);
+	}
+	size_t anon1, huge1;
+	anon_bytes(anon1, huge1);
+	const double added = anon1 > anon0 ? double(anon1 - anon0) : 0;
+	const double huge = huge1 > huge0 ? double(huge1 - huge0) : 0;
+	printf("# %s: %.0f MiB added, %.0f%% of it on huge pages\n", name.c_str(), added / (1 << 20),
+		   added ? 100 * huge / added : 0);
+}
+
+template<typename _Map>
+void lookups_of(runner& r, const _Map& m, const std::vector<uint64_t>& keys, const std::string& suffix)
+{
+	std::vector<uint64_t> probes(lookups);
+	for (size_t i = 0; i != probes.size(); ++i) {
+		probes[i] = keys[mix64(i + 1) % keys.size()];
+	}
+	r.run("find" + suffix, lookups, [&](timer& t) {
+		uint64_t sum = 0;
+		t.start();
+		for (size_t i = 0; i != probes.size(); ++i) {
+			sum += m.find(probes[i])->second;
+		}
+		t.stop();
+		keep(sum);
+	});
+	r.run("find_chain" + suffix, lookups, [&](timer& t) {
+		uint64_t at = 0;
+		t.start();
+		for (size_t i = 0; i != lookups; ++i) {
+			at = m.find(keys[at])->second;
+		}
+		t.stop();
+		keep(at);
+	});
+}
+
+void run_arena(runner& r, const std::vector<uint64_t>& keys, hugepage_arena::page_mode mode, const std::string& suffix)
+{
+	typedef std::pair<const uint64_t, uint64_t> value_type;
+	typedef hugepage_allocator<value_type> allocator_type;
+	hugepage_arena arena(64 * hugepage_arena::huge_page_size, mode);
+	linked_map<uint64_t, uint64_t, std::less<uint64_t>, allocator_type> m((allocator_type(arena)));
+	build(m, keys, suffix.substr(1));
+	printf("# %s: arena page mode %s\n", suffix.substr(1).c_str(), mode_name(arena.mode()));
+	lookups_of(r, m, keys, suffix);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	runner r(argc, argv, 10000000);
+	const size_t sizes[] = { 1000000, 10000000, 30000000, 100000000 };
+	for (size_t s = 0; s != sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= r.max_size(); ++s) {
+		const size_t n = sizes[s];
+		std::vector<uint64_t> keys(n);
+		for (size_t i = 0; i != n; ++i) {
+			keys[i] = mix64(i);
+		}
+
+		{
+			const std::string suffix = "/std::allocator/4k/" + std::to_string(n);
+			prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0);
+			linked_map<uint64_t, uint64_t> m;
+			build(m, keys, suffix.substr(1));
+			// still off, or khugepaged may collapse the map while it is looked up
+			lookups_of(r, m, keys, suffix);
+		}
+		prctl(PR_SET_THP_DISABLE, 0, 0, 0, 0);
+		// give the freed nodes back, so the next map doesn't reuse their pages
+		malloc_trim(0);
+		{
+			const std::string suffix = "/std::allocator/" + std::to_string(n);
+			linked_map<uint64_t, uint64_t> m;
+			build(m, keys, suffix.substr(1));
+			lookups_of(r, m, keys, suffix);
+		}
+		malloc_trim(0);
+		run_arena(r, keys, hugepage_arena::hugetlb, "/hugepage_allocator/" + std::to_string(n));
+		prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0);
+		run_arena(r, keys, hugepage_arena::regular, "/hugepage_allocator/4k/" + std::to_string(n));
+		prctl(PR_SET_THP_DISABLE, 0, 0, 0, 0);
+	}
+	return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file bench/linked_map_io_check.cc
+ * @brief Opens damaged and hostile linked_map files, which must be rejected rather than read out of bounds.
+ *
+ * Run by `make check`; prints every case and exits with 1 if one of them
+ * isn't rejected. Files are written to $TMPDIR, /tmp by default.
+ */
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "container/linked_map_io.h"
+
+using namespace ant;
+
+namespace {
+
+typedef linked_map_view<uint64_t, uint64_t> view_type;
+
+int failures = 0;
+
+std::string temp_path()
+{
+	const char* dir = getenv("TMPDIR");
+	return std::string(dir ? dir : "/tmp") + "/linked_map_io_check." + std::to_string(getpid());
+}
+
+void write_file(const std::string& path, const std::string& bytes)
+{
+	std::ofstream os(path.c_str(), std::ios::binary | std::ios::trunc);
+	os.write(bytes.data(), bytes.size());
+}
+
+std::string read_file(const std::string& path)
+{
+	std::ifstream is(path.c_str(), std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+linked_map_file_header& header_of(std::string& bytes)
+{
+	return *reinterpret_cast<linked_map_file_header*>(&bytes[0]);
+}
+
+// Writes bytes to path, then expects opening it and looking up every key up to 100 to throw.
+void expect_rejected(const char* name, const std::string& path, const std::string& bytes)
+{
+	write_file(path, bytes);
+	try {
+		view_type v(path);
+		for (uint64_t k = 0; k != 100; ++k) {
+			v.find(k);
+		}
+		for (view_type::link_iterator it = v.link_begin(); it != v.link_end(); ++it) {
+		}
+	} catch (const std::runtime_error& e) {
+		printf("ok      %-40s %s\n", name, e.what());
+		return;
+	}
+	printf("FAILED  %-40s accepted\n", name);
+	++failures;
+}
+
+}
+
+int main()
+{
+	const std::string path = temp_path();
+	linked_map<uint64_t, uint64_t> m;
+	for (uint64_t i = 0; i != 100; ++i) {
+		m[i * 7 % 100] = i;
+	}
+	save_linked_map(m, path);
+	const std::string good = read_file(path);
+
+	{
+		view_type v(path);
+		uint64_t found = 0;
+		for (uint64_t k = 0; k != 100; ++k) {
+			found += v.find(k) != v.link_end();
+		}
+		printf("%-7s %-40s %llu of 100 keys found\n", found == 100 ? "ok" : "FAILED", "intact file",
+			   static_cast<unsigned long long>(found));
+		failures += found != 100;
+	}
+
+	{
+		// count_ * 8 wraps around to the bytes left after indexOffset_, which lies past the end
+		std::string b = good.substr(0, sizeof(linked_map_file_header));
+		header_of(b).indexOffset_ = 72;
+		header_of(b).count_ = (uint64_t(1) << 61) - 1;
+		header_of(b).fileSize_ = b.size();
+		expect_rejected("index offset past the end of the file", path, b);
+	}
+	{
+		std::string b = good;
+		header_of(b).count_ += 1;
+		expect_rejected("count larger than the index", path, b);
+	}
+	{
+		std::string b = good;
+		uint64_t off = uint64_t(1) << 40;
+		memcpy(&b[header_of(b).indexOffset_ + 8 * 50], &off, 8);
+		expect_rejected("index entry out of bounds", path, b);
+	}
+	{
+		std::string b = good;
+		uint32_t klen = 0xfffffff0;
+		memcpy(&b[header_of(b).recordsOffset_], &klen, 4);
+		expect_rejected("record running past the records", path, b);
+	}
+	{
+		std::string b = good;
+		header_of(b).valueTag_ = binary_codec<double>::tag;
+		expect_rejected("values written as another type", path, b);
+	}
+
+	unlink(path.c_str());
+	return failures ? 1 : 0;
+}
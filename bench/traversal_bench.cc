@@ -0,0 +1,188 @@
+/**
+ * @file bench/traversal_bench.cc
+ * @brief Prefetching bulk traversal against plain iterator loops.
+ *
+ * The map is churned before it is scanned: after N inserts, N rounds each
+ * erase a random element and insert a new key, so both key order and link
+ * order visit nodes scattered across the heap, as in a long-lived map. The
+ * largest size, 8M elements of about 80 bytes each, is well past the last
+ * level cache of most machines.
+ *
+ * The .../work variants give the callback about as much work per element as
+ * a cache miss costs, the case the prefetch is meant for: the misses of the
+ * nodes ahead overlap with that work. The compacted runs repeat the link
+ * order scan after compact() has laid the nodes out in link order.
+ */
+
+#include "container/linked_map.h"
+
+#include "bench.h"
+
+using namespace ant;
+using namespace ant::bench;
+
+namespace {
+
+typedef linked_map<int64_t, int64_t> map_type;
+
+struct summer {
+	summer() : sum(0)
+	{
+	}
+
+	void operator()(const map_type::value_type& v)
+	{
+		sum += v.second;
+	}
+
+	void operator()(const map_type::value_type* const* v, size_t n)
+	{
+		for (size_t i = 0; i != n; ++i) {
+			sum += v[i]->second;
+		}
+	}
+
+	int64_t	sum;
+};
+
+// Some arithmetic standing in for real per-element work.
+inline int64_t work(int64_t v)
+{
+	uint64_t x = static_cast<uint64_t>(v);
+	for (int i = 0; i != 16; ++i) {
+		x = mix64(x);
+	}
+	return static_cast<int64_t>(x);
+}
+
+struct worker {
+	worker() : sum(0)
+	{
+	}
+
+	void operator()(const map_type::value_type& v)
+	{
+		sum += work(v.second + v.first);
+	}
+
+	int64_t	sum;
+};
+
+void build(map_type& m, size_t n)
+{
+	std::vector<int64_t> live;
+	live.reserve(n);
+	uint64_t next = 0;
+	for (; next != n; ++next) {
+		live.push_back(static_cast<int64_t>(mix64(next)));
+		m.insert(map_type::value_type(live.back(), 1));
+	}
+	for (size_t i = 0; i != n; ++i) {
+		size_t victim = mix64(next ^ 0x5bd1e995) % n;
+		m.erase(live[victim]);
+		live[victim] = static_cast<int64_t>(mix64(next++));
+		m.insert(map_type::value_type(live[victim], 1));
+	}
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	runner r(argc, argv, 8000000);
+	const size_t sizes[] = { 100000, 1000000, 8000000 };
+	for (size_t s = 0; s != sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= r.max_size(); ++s) {
+		const size_t n = sizes[s];
+		const std::string suffix = "/" + std::to_string(n);
+		map_type m;
+		build(m, n);
+		const map_type& cm = m;
+
+		r.run("key/iterator_loop" + suffix, n, [&](timer& t) {
+			int64_t sum = 0;
+			t.start();
+			for (map_type::const_iterator it = cm.begin(); it != cm.end(); ++it) {
+				sum += it->second;
+			}
+			t.stop();
+			keep(sum);
+		});
+		r.run("key/for_each" + suffix, n, [&](timer& t) {
+			t.start();
+			summer f = cm.for_each(summer());
+			t.stop();
+			keep(f.sum);
+		});
+		r.run("key/for_each_batch" + suffix, n, [&](timer& t) {
+			t.start();
+			summer f = cm.for_each_batch(summer());
+			t.stop();
+			keep(f.sum);
+		});
+
+		r.run("key/iterator_loop/work" + suffix, n, [&](timer& t) {
+			int64_t sum = 0;
+			t.start();
+			for (map_type::const_iterator it = cm.begin(); it != cm.end(); ++it) {
+				sum += work(it->second + it->first);
+			}
+			t.stop();
+			keep(sum);
+		});
+		r.run("key/for_each/work" + suffix, n, [&](timer& t) {
+			t.start();
+			worker f = cm.for_each(worker());
+			t.stop();
+			keep(f.sum);
+		});
+
+		r.run("link/iterator_loop" + suffix, n, [&](timer& t) {
+			int64_t sum = 0;
+			t.start();
+			for (map_type::const_link_iterator it = cm.link_begin(); it != cm.link_end(); ++it) {
+				sum += it->second;
+			}
+			t.stop();
+			keep(sum);
+		});
+		r.run("link/for_each_link" + suffix, n, [&](timer& t) {
+			t.start();
+			summer f = cm.for_each_link(summer());
+			t.stop();
+			keep(f.sum);
+		});
+		r.run("link/for_each_link_batch" + suffix, n, [&](timer& t) {
+			t.start();
+			summer f = cm.for_each_link_batch(summer());
+			t.stop();
+			keep(f.sum);
+		});
+		r.run("link/iterator_loop/work" + suffix, n, [&](timer& t) {
+			int64_t sum = 0;
+			t.start();
+			for (map_type::const_link_iterator it = cm.link_begin(); it != cm.link_end(); ++it) {
+				sum += work(it->second + it->first);
+			}
+			t.stop();
+			keep(sum);
+		});
+		r.run("link/for_each_link/work" + suffix, n, [&](timer& t) {
+			t.start();
+			worker f = cm.for_each_link(worker());
+			t.stop();
+			keep(f.sum);
+		});
+
+		m.compact();
+		r.run("link/iterator_loop/compacted" + suffix, n, [&](timer& t) {
+			int64_t sum = 0;
+			t.start();
+			for (map_type::const_link_iterator it = cm.link_begin(); it != cm.link_end(); ++it) {
+				sum += it->second;
+			}
+			t.stop();
+			keep(sum);
+		});
+	}
+	return 0;
+}
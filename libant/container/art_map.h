@@ -0,0 +1,1824 @@
+/**
+ * @file container/art_map.h
+ * @brief Adaptive radix tree map keyed by strings, with insertion order chaining.
+ */
+
+#ifndef LIBANT_CONTAINER_ART_MAP_H_
+#define LIBANT_CONTAINER_ART_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "small_string.h"
+
+namespace ant {
+
+/**
+ * @brief Gives art_map the bytes of a key. Keys are ordered by unsigned byte comparison.
+ *
+ * The primary template works for any string type with data() and size().
+ */
+template<typename _Key>
+struct art_key_traits {
+	static const unsigned char* data(const _Key& key)
+	{
+		return reinterpret_cast<const unsigned char*>(key.data());
+	}
+
+	static size_t size(const _Key& key)
+	{
+		return key.size();
+	}
+};
+
+/**
+ * @brief A map from strings to values built on an adaptive radix tree (ART).
+ *
+ * Lookups walk the key one byte per level, skipping shared runs of bytes
+ * stored in the inner nodes as compressed prefixes, and compare the whole
+ * key only once at the leaf. Inner nodes grow from 4 to 16, 48 and 256
+ * children and shrink back as keys are erased, so long keys with common
+ * prefixes such as "tenant:region:object" are stored compactly.
+ *
+ * The interface follows linked_map: iterators, find(), lower_bound() and
+ * upper_bound() work in key order, and every element also sits in a doubly
+ * linked list in insertion order, traversed with link iterators.
+ * for_each() and for_each_prefix() visit elements in key order, the latter
+ * only those whose keys start with a given prefix.
+ *
+ * Incrementing or decrementing an iterator descends the tree again for the
+ * neighbouring key, so it costs about as much as a lookup; for_each() is the
+ * cheaper way to visit every element in key order.
+ *
+ * Iterators, link iterators, pointers and references to elements are never
+ * invalidated except by erasing that element.
+ */
+template<typename _Key, typename _Tp, typename _Alloc = std::allocator<std::pair<const _Key, _Tp> > >
+class art_map {
+public:
+	typedef _Key key_type;
+	typedef _Tp mapped_type;
+	typedef std::pair<const _Key, _Tp> value_type;
+	typedef _Alloc allocator_type;
+	typedef size_t size_type;
+	typedef art_key_traits<_Key> key_traits;
+
+private:
+	struct link_node {
+		link_node*	prev_;
+		link_node*	next_;
+	};
+
+	struct leaf : public link_node {
+		template<typename... _Args>
+		leaf(_Args&&... args) : value_(std::forward<_Args>(args)...)
+		{
+		}
+
+		value_type	value_;
+	};
+
+	enum {
+		node4_type,
+		node16_type,
+		node48_type,
+		node256_type
+	};
+
+	static const size_t max_prefix = 8;
+
+	// Header shared by the inner nodes. Children are tagged pointers: a set
+	// low bit means the child is a leaf.
+	struct inner {
+		uint8_t			type_;
+		uint16_t		count_;				// number of children
+		uint32_t		prefixLen_;			// length of the compressed prefix
+		unsigned char	prefix_[max_prefix];	// leading bytes of the compressed prefix
+		leaf*			terminal_;			// element whose key ends at this node
+	};
+
+	struct node4 : public inner {
+		unsigned char	keys_[4];	// sorted
+		void*			children_[4];
+	};
+
+	struct node16 : public inner {
+		unsigned char	keys_[16];	// sorted
+		void*			children_[16];
+	};
+
+	struct node48 : public inner {
+		unsigned char	index_[256];	// 1-based index into children_, 0 if absent
+		void*			children_[48];
+	};
+
+	struct node256 : public inner {
+		void*			children_[256];
+	};
+
+	template<bool _Const>
+	class link_iter {
+		typedef typename std::conditional<_Const, const link_node*, link_node*>::type node_pointer;
+		typedef typename std::conditional<_Const, const leaf*, leaf*>::type leaf_pointer;
+
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef typename art_map::value_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef typename std::conditional<_Const, const value_type*, value_type*>::type pointer;
+		typedef typename std::conditional<_Const, const value_type&, value_type&>::type reference;
+
+	public:
+		link_iter() : node_(0)
+		{
+		}
+
+		// link_iterator to const_link_iterator
+		template<bool _C, typename = typename std::enable_if<_Const && !_C>::type>
+		link_iter(const link_iter<_C>& rhs) : node_(rhs.node_)
+		{
+		}
+
+		reference operator*() const
+		{
+			return static_cast<leaf_pointer>(node_)->value_;
+		}
+
+		pointer operator->() const
+		{
+			return std::__addressof(static_cast<leaf_pointer>(node_)->value_);
+		}
+
+		link_iter& operator++()
+		{
+			node_ = node_->next_;
+			return *this;
+		}
+
+		link_iter operator++(int)
+		{
+			link_iter tmp = *this;
+			node_ = node_->next_;
+			return tmp;
+		}
+
+		link_iter& operator--()
+		{
+			node_ = node_->prev_;
+			return *this;
+		}
+
+		link_iter operator--(int)
+		{
+			link_iter tmp = *this;
+			node_ = node_->prev_;
+			return tmp;
+		}
+
+		template<bool _C>
+		bool operator==(const link_iter<_C>& rhs) const
+		{
+			return node_ == rhs.node_;
+		}
+
+		template<bool _C>
+		bool operator!=(const link_iter<_C>& rhs) const
+		{
+			return node_ != rhs.node_;
+		}
+
+	private:
+		explicit link_iter(node_pointer node) : node_(node)
+		{
+		}
+
+		friend class art_map;
+		template<bool> friend class link_iter;
+
+	private:
+		node_pointer	node_;
+	};
+
+	// Key order iterator. It keeps only the element; moving it looks up the
+	// neighbouring key, so it stays valid while other elements come and go.
+	template<bool _Const>
+	class iter {
+		typedef typename std::conditional<_Const, const leaf*, leaf*>::type leaf_pointer;
+
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef typename art_map::value_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef typename std::conditional<_Const, const value_type*, value_type*>::type pointer;
+		typedef typename std::conditional<_Const, const value_type&, value_type&>::type reference;
+
+	public:
+		iter() : map_(0), leaf_(0)
+		{
+		}
+
+		// iterator to const_iterator
+		template<bool _C, typename = typename std::enable_if<_Const && !_C>::type>
+		iter(const iter<_C>& rhs) : map_(rhs.map_), leaf_(rhs.leaf_)
+		{
+		}
+
+		reference operator*() const
+		{
+			return leaf_->value_;
+		}
+
+		pointer operator->() const
+		{
+			return std::__addressof(leaf_->value_);
+		}
+
+		iter& operator++()
+		{
+			leaf_ = map_->bound_leaf(leaf_key(leaf_), leaf_key_size(leaf_), true);
+			return *this;
+		}
+
+		iter operator++(int)
+		{
+			iter tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		// --end() is the element with the largest key
+		iter& operator--()
+		{
+			leaf_ = leaf_ ? map_->prev_leaf(leaf_key(leaf_), leaf_key_size(leaf_)) : maximum(map_->root_);
+			return *this;
+		}
+
+		iter operator--(int)
+		{
+			iter tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		template<bool _C>
+		bool operator==(const iter<_C>& rhs) const
+		{
+			return leaf_ == rhs.leaf_;
+		}
+
+		template<bool _C>
+		bool operator!=(const iter<_C>& rhs) const
+		{
+			return leaf_ != rhs.leaf_;
+		}
+
+	private:
+		iter(const art_map* map, leaf_pointer l) : map_(map), leaf_(l)
+		{
+		}
+
+		friend class art_map;
+		template<bool> friend class iter;
+
+	private:
+		const art_map*	map_;
+		leaf_pointer	leaf_;	// 0 for end()
+	};
+
+public:
+	typedef iter<false> iterator;
+	typedef iter<true> const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef link_iter<false> link_iterator;
+	typedef link_iter<true> const_link_iterator;
+	typedef std::reverse_iterator<link_iterator> reverse_link_iterator;
+	typedef std::reverse_iterator<const_link_iterator> const_reverse_link_iterator;
+
+public:
+	art_map() : root_(0), size_(0)
+	{
+		reset_links();
+	}
+
+	explicit art_map(const allocator_type& alloc) : root_(0), size_(0), alloc_(alloc)
+	{
+		reset_links();
+	}
+
+	art_map(std::initializer_list<value_type> l, const allocator_type& alloc = allocator_type())
+		: root_(0), size_(0), alloc_(alloc)
+	{
+		reset_links();
+		try {
+			for (auto& v : l) {
+				insert(v);
+			}
+		} catch (...) {
+			clear();
+			throw;
+		}
+	}
+
+	/**
+	 * @brief Copies the elements of rhs, keeping their link order.
+	 */
+	art_map(const art_map& rhs)
+		: art_map(rhs, alloc_traits::select_on_container_copy_construction(rhs.alloc_))
+	{
+	}
+
+	art_map(const art_map& rhs, const allocator_type& alloc) : root_(0), size_(0), alloc_(alloc)
+	{
+		reset_links();
+		try {
+			for (const_link_iterator it = rhs.link_begin(); it != rhs.link_end(); ++it) {
+				insert(*it);
+			}
+		} catch (...) {
+			clear();
+			throw;
+		}
+	}
+
+	art_map(art_map&& rhs) noexcept : root_(0), size_(0), alloc_(rhs.alloc_)
+	{
+		reset_links();
+		steal(rhs);
+	}
+
+	~art_map()
+	{
+		clear();
+	}
+
+	/**
+	 * @brief Copies rhs. The allocator is copied too if the allocator propagates on copy assignment.
+	 */
+	art_map& operator=(const art_map& rhs)
+	{
+		if (&rhs != this) {
+			art_map tmp(rhs, alloc_traits::propagate_on_container_copy_assignment::value ? rhs.alloc_ : alloc_);
+			clear();
+			steal(tmp);
+			assign_alloc(rhs.alloc_, typename alloc_traits::propagate_on_container_copy_assignment());
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Takes over the elements of rhs, or moves them one by one if the
+	 * allocators differ and the allocator does not propagate on move assignment.
+	 */
+	art_map& operator=(art_map&& rhs)
+	{
+		if (&rhs != this) {
+			if (alloc_traits::propagate_on_container_move_assignment::value || alloc_ == rhs.alloc_) {
+				clear();
+				steal(rhs);
+				assign_alloc(rhs.alloc_, typename alloc_traits::propagate_on_container_move_assignment());
+			} else {
+				art_map tmp(alloc_);
+				tmp.move_elements(rhs);
+				clear();
+				steal(tmp);
+				rhs.clear();
+			}
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Swaps the elements, and the allocators if the allocator propagates on swap.
+	 * Elements are moved one by one if the allocators differ and don't propagate.
+	 */
+	void swap(art_map& rhs)
+	{
+		if (alloc_traits::propagate_on_container_swap::value || alloc_ == rhs.alloc_) {
+			art_map tmp(std::move(rhs));
+			rhs.steal(*this);
+			steal(tmp);
+			swap_alloc(rhs, typename alloc_traits::propagate_on_container_swap());
+		} else {
+			art_map mine(alloc_);
+			mine.move_elements(rhs);
+			art_map theirs(rhs.alloc_);
+			theirs.move_elements(*this);
+			clear();
+			steal(mine);
+			rhs.clear();
+			rhs.steal(theirs);
+		}
+	}
+
+	allocator_type get_allocator() const
+	{
+		return alloc_;
+	}
+
+	size_type size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	// key order iteration
+
+	iterator begin()
+	{
+		return iterator(this, root_ ? minimum(root_) : 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, 0);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, root_ ? minimum(root_) : 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+
+	const_iterator cend() const
+	{
+		return end();
+	}
+
+	reverse_iterator rbegin()
+	{
+		return reverse_iterator(end());
+	}
+
+	reverse_iterator rend()
+	{
+		return reverse_iterator(begin());
+	}
+
+	const_reverse_iterator rbegin() const
+	{
+		return const_reverse_iterator(end());
+	}
+
+	const_reverse_iterator rend() const
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	// link order iteration
+
+	link_iterator link_begin()
+	{
+		return link_iterator(header_.next_);
+	}
+
+	link_iterator link_end()
+	{
+		return link_iterator(&header_);
+	}
+
+	const_link_iterator link_begin() const
+	{
+		return const_link_iterator(header_.next_);
+	}
+
+	const_link_iterator link_end() const
+	{
+		return const_link_iterator(&header_);
+	}
+
+	const_link_iterator link_cbegin() const
+	{
+		return link_begin();
+	}
+
+	const_link_iterator link_cend() const
+	{
+		return link_end();
+	}
+
+	reverse_link_iterator link_rbegin()
+	{
+		return reverse_link_iterator(link_end());
+	}
+
+	reverse_link_iterator link_rend()
+	{
+		return reverse_link_iterator(link_begin());
+	}
+
+	const_reverse_link_iterator link_rbegin() const
+	{
+		return const_reverse_link_iterator(link_end());
+	}
+
+	const_reverse_link_iterator link_rend() const
+	{
+		return const_reverse_link_iterator(link_begin());
+	}
+
+	// lookup
+
+	iterator find(const key_type& key)
+	{
+		return iterator(this, find_leaf(key_traits::data(key), key_traits::size(key)));
+	}
+
+	const_iterator find(const key_type& key) const
+	{
+		return const_iterator(this, find_leaf(key_traits::data(key), key_traits::size(key)));
+	}
+
+	/**
+	 * @return iterator to the first element whose key is not less than key
+	 */
+	iterator lower_bound(const key_type& key)
+	{
+		return iterator(this, bound_leaf(key_traits::data(key), key_traits::size(key), false));
+	}
+
+	const_iterator lower_bound(const key_type& key) const
+	{
+		return const_iterator(this, bound_leaf(key_traits::data(key), key_traits::size(key), false));
+	}
+
+	/**
+	 * @return iterator to the first element whose key is greater than key
+	 */
+	iterator upper_bound(const key_type& key)
+	{
+		return iterator(this, bound_leaf(key_traits::data(key), key_traits::size(key), true));
+	}
+
+	const_iterator upper_bound(const key_type& key) const
+	{
+		return const_iterator(this, bound_leaf(key_traits::data(key), key_traits::size(key), true));
+	}
+
+	std::pair<iterator, iterator> equal_range(const key_type& key)
+	{
+		iterator first = lower_bound(key);
+		iterator last = first;
+		if (last != end() && leaf_matches(last.leaf_, key_traits::data(key), key_traits::size(key))) {
+			++last;
+		}
+		return std::make_pair(first, last);
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+	{
+		const_iterator first = lower_bound(key);
+		const_iterator last = first;
+		if (last != end() && leaf_matches(last.leaf_, key_traits::data(key), key_traits::size(key))) {
+			++last;
+		}
+		return std::make_pair(first, last);
+	}
+
+	size_type count(const key_type& key) const
+	{
+		return find_leaf(key_traits::data(key), key_traits::size(key)) ? 1 : 0;
+	}
+
+	mapped_type& at(const key_type& key)
+	{
+		leaf* l = find_leaf(key_traits::data(key), key_traits::size(key));
+		if (!l) {
+			throw std::out_of_range("art_map::at");
+		}
+		return l->value_.second;
+	}
+
+	const mapped_type& at(const key_type& key) const
+	{
+		leaf* l = find_leaf(key_traits::data(key), key_traits::size(key));
+		if (!l) {
+			throw std::out_of_range("art_map::at");
+		}
+		return l->value_.second;
+	}
+
+	mapped_type& operator[](const key_type& key)
+	{
+		leaf* l = find_leaf(key_traits::data(key), key_traits::size(key));
+		if (!l) {
+			l = emplace_leaf(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>()).first;
+		}
+		return l->value_.second;
+	}
+
+	mapped_type& operator[](key_type&& key)
+	{
+		leaf* l = find_leaf(key_traits::data(key), key_traits::size(key));
+		if (!l) {
+			l = emplace_leaf(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::tuple<>()).first;
+		}
+		return l->value_.second;
+	}
+
+	/**
+	 * @brief Calls f(value_type&) on every element in key order.
+	 * @return f
+	 */
+	template<typename _Function>
+	_Function for_each(_Function f)
+	{
+		if (root_) {
+			walk(root_, f);
+		}
+		return f;
+	}
+
+	template<typename _Function>
+	_Function for_each(_Function f) const
+	{
+		const_visitor<_Function> v(f);
+		if (root_) {
+			walk(root_, v);
+		}
+		return f;
+	}
+
+	/**
+	 * @brief Calls f(value_type&) in key order on every element whose key starts with prefix.
+	 *
+	 * Finding the subtree costs the same as a lookup of prefix; the cost of
+	 * the visit is then proportional to the number of elements visited.
+	 *
+	 * @return f
+	 */
+	template<typename _Function>
+	_Function for_each_prefix(const key_type& prefix, _Function f)
+	{
+		return for_each_prefix(key_traits::data(prefix), key_traits::size(prefix), f);
+	}
+
+	template<typename _Function>
+	_Function for_each_prefix(const key_type& prefix, _Function f) const
+	{
+		return for_each_prefix(key_traits::data(prefix), key_traits::size(prefix), f);
+	}
+
+	template<typename _Function>
+	_Function for_each_prefix(const void* prefix, size_t len, _Function f)
+	{
+		void* subtree = find_prefix(static_cast<const unsigned char*>(prefix), len);
+		if (subtree) {
+			walk(subtree, f);
+		}
+		return f;
+	}
+
+	template<typename _Function>
+	_Function for_each_prefix(const void* prefix, size_t len, _Function f) const
+	{
+		void* subtree = find_prefix(static_cast<const unsigned char*>(prefix), len);
+		if (subtree) {
+			const_visitor<_Function> v(f);
+			walk(subtree, v);
+		}
+		return f;
+	}
+
+	// modifiers
+
+	/**
+	 * @brief Constructs value_type(args...) and appends it unless its key is already present.
+	 * @return iterator to the element with the key, and true if it was inserted
+	 */
+	template<typename... _Args>
+	std::pair<iterator, bool> emplace(_Args&&... args)
+	{
+		std::pair<leaf*, bool> ret = emplace_leaf(std::forward<_Args>(args)...);
+		return std::make_pair(iterator(this, ret.first), ret.second);
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value)
+	{
+		return emplace(value);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& value)
+	{
+		return emplace(std::move(value));
+	}
+
+	/**
+	 * @return number of elements erased
+	 */
+	size_type erase(const key_type& key)
+	{
+		leaf* l = erase_rec(&root_, key_traits::data(key), key_traits::size(key), 0);
+		if (!l) {
+			return 0;
+		}
+		destroy_leaf(l);
+		return 1;
+	}
+
+	/**
+	 * @return iterator to the element following the erased one in key order
+	 */
+	iterator erase(const_iterator it)
+	{
+		const key_type& key = it->first;
+		iterator next(this, bound_leaf(key_traits::data(key), key_traits::size(key), true));
+		destroy_leaf(erase_rec(&root_, key_traits::data(key), key_traits::size(key), 0));
+		return next;
+	}
+
+	/**
+	 * @return iterator to the element inserted after the erased one
+	 */
+	link_iterator erase(const_link_iterator it)
+	{
+		const key_type& key = it->first;
+		link_iterator next(const_cast<link_node*>(it.node_)->next_);
+		destroy_leaf(erase_rec(&root_, key_traits::data(key), key_traits::size(key), 0));
+		return next;
+	}
+
+	void clear()
+	{
+		if (root_) {
+			free_tree(root_);
+			root_ = 0;
+		}
+		for (link_node* n = header_.next_; n != &header_; ) {
+			leaf* l = static_cast<leaf*>(n);
+			n = n->next_;
+			l->~leaf();
+			leaf_allocator a(alloc_);
+			leaf_alloc_traits::deallocate(a, l, 1);
+		}
+		size_ = 0;
+		reset_links();
+	}
+
+private:
+	typedef std::allocator_traits<allocator_type> alloc_traits;
+	typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<leaf> leaf_allocator;
+	typedef std::allocator_traits<leaf_allocator> leaf_alloc_traits;
+
+	// Adapts a visitor taking const value_type& to the walk below.
+	template<typename _Function>
+	struct const_visitor {
+		explicit const_visitor(_Function& f) : f_(f)
+		{
+		}
+
+		void operator()(value_type& v)
+		{
+			f_(static_cast<const value_type&>(v));
+		}
+
+		_Function&	f_;
+	};
+
+	static bool is_leaf(const void* p)
+	{
+		return reinterpret_cast<uintptr_t>(p) & 1;
+	}
+
+	static leaf* to_leaf(const void* p)
+	{
+		return reinterpret_cast<leaf*>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(1));
+	}
+
+	static void* from_leaf(leaf* l)
+	{
+		return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(l) | 1);
+	}
+
+	static inner* to_inner(void* p)
+	{
+		return static_cast<inner*>(p);
+	}
+
+	static const unsigned char* leaf_key(const leaf* l)
+	{
+		return key_traits::data(l->value_.first);
+	}
+
+	static size_t leaf_key_size(const leaf* l)
+	{
+		return key_traits::size(l->value_.first);
+	}
+
+	static bool leaf_matches(const leaf* l, const unsigned char* key, size_t len)
+	{
+		return leaf_key_size(l) == len && (len == 0 || memcmp(leaf_key(l), key, len) == 0);
+	}
+
+	static bool leaf_has_prefix(const leaf* l, const unsigned char* prefix, size_t len)
+	{
+		return leaf_key_size(l) >= len && (len == 0 || memcmp(leaf_key(l), prefix, len) == 0);
+	}
+
+	static size_t min_size(size_t a, size_t b)
+	{
+		return a < b ? a : b;
+	}
+
+	void reset_links()
+	{
+		header_.prev_ = &header_;
+		header_.next_ = &header_;
+	}
+
+	void link_back(leaf* l)
+	{
+		l->prev_ = header_.prev_;
+		l->next_ = &header_;
+		header_.prev_->next_ = l;
+		header_.prev_ = l;
+	}
+
+	static void unlink(leaf* l)
+	{
+		l->prev_->next_ = l->next_;
+		l->next_->prev_ = l->prev_;
+	}
+
+	/**
+	 * @brief Moves the elements of rhs into *this one by one, in link order. rhs keeps them, moved from.
+	 */
+	void move_elements(art_map& rhs)
+	{
+		for (link_iterator it = rhs.link_begin(); it != rhs.link_end(); ++it) {
+			emplace(std::move(*it));
+		}
+	}
+
+	void assign_alloc(const allocator_type& alloc, std::true_type)
+	{
+		alloc_ = alloc;
+	}
+
+	void assign_alloc(const allocator_type&, std::false_type)
+	{
+	}
+
+	void swap_alloc(art_map& rhs, std::true_type)
+	{
+		using std::swap;
+		swap(alloc_, rhs.alloc_);
+	}
+
+	void swap_alloc(art_map&, std::false_type)
+	{
+	}
+
+	/**
+	 * @brief Takes over the elements of rhs, leaving it empty. *this must be empty.
+	 */
+	void steal(art_map& rhs)
+	{
+		root_ = rhs.root_;
+		size_ = rhs.size_;
+		if (rhs.header_.next_ != &rhs.header_) {
+			header_ = rhs.header_;
+			header_.next_->prev_ = &header_;
+			header_.prev_->next_ = &header_;
+		}
+		rhs.root_ = 0;
+		rhs.size_ = 0;
+		rhs.reset_links();
+	}
+
+	// node management
+
+	template<typename _Node>
+	_Node* new_node(uint8_t type)
+	{
+		typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<_Node> node_allocator;
+		node_allocator a(alloc_);
+		_Node* n = std::allocator_traits<node_allocator>::allocate(a, 1);
+		::new (static_cast<void*>(n)) _Node();
+		n->type_ = type;
+		return n;
+	}
+
+	template<typename _Node>
+	void delete_node(inner* n)
+	{
+		typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<_Node> node_allocator;
+		node_allocator a(alloc_);
+		std::allocator_traits<node_allocator>::deallocate(a, static_cast<_Node*>(n), 1);
+	}
+
+	void free_node(inner* n)
+	{
+		switch (n->type_) {
+		case node4_type:
+			delete_node<node4>(n);
+			break;
+		case node16_type:
+			delete_node<node16>(n);
+			break;
+		case node48_type:
+			delete_node<node48>(n);
+			break;
+		default:
+			delete_node<node256>(n);
+			break;
+		}
+	}
+
+	// Frees the inner nodes of a subtree. Leaves are freed through the link list.
+	void free_tree(void* p)
+	{
+		if (is_leaf(p)) {
+			return;
+		}
+		inner* n = to_inner(p);
+		for_each_child(n, [this](unsigned char, void* child) { free_tree(child); });
+		free_node(n);
+	}
+
+	static void copy_header(inner* dst, const inner* src)
+	{
+		dst->count_ = src->count_;
+		dst->prefixLen_ = src->prefixLen_;
+		memcpy(dst->prefix_, src->prefix_, max_prefix);
+		dst->terminal_ = src->terminal_;
+	}
+
+	/**
+	 * @brief Calls f(byte, child) for every child of n in byte order.
+	 */
+	template<typename _Fn>
+	static void for_each_child(inner* n, _Fn f)
+	{
+		switch (n->type_) {
+		case node4_type: {
+			node4* n4 = static_cast<node4*>(n);
+			for (unsigned i = 0; i != n4->count_; ++i) {
+				f(n4->keys_[i], n4->children_[i]);
+			}
+			break;
+		}
+		case node16_type: {
+			node16* n16 = static_cast<node16*>(n);
+			for (unsigned i = 0; i != n16->count_; ++i) {
+				f(n16->keys_[i], n16->children_[i]);
+			}
+			break;
+		}
+		case node48_type: {
+			node48* n48 = static_cast<node48*>(n);
+			for (unsigned b = 0; b != 256; ++b) {
+				if (n48->index_[b]) {
+					f(static_cast<unsigned char>(b), n48->children_[n48->index_[b] - 1]);
+				}
+			}
+			break;
+		}
+		default: {
+			node256* n256 = static_cast<node256*>(n);
+			for (unsigned b = 0; b != 256; ++b) {
+				if (n256->children_[b]) {
+					f(static_cast<unsigned char>(b), n256->children_[b]);
+				}
+			}
+			break;
+		}
+		}
+	}
+
+	/**
+	 * @return the slot of the child for byte c, or 0 if there is none
+	 */
+	static void** find_child(inner* n, unsigned char c)
+	{
+		switch (n->type_) {
+		case node4_type: {
+			node4* n4 = static_cast<node4*>(n);
+			for (unsigned i = 0; i != n4->count_; ++i) {
+				if (n4->keys_[i] == c) {
+					return &n4->children_[i];
+				}
+			}
+			return 0;
+		}
+		case node16_type: {
+			node16* n16 = static_cast<node16*>(n);
+#ifdef __SSE2__
+			__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(c)),
+											_mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys_)));
+			unsigned mask = _mm_movemask_epi8(cmp) & ((1u << n16->count_) - 1);
+			return mask ? &n16->children_[__builtin_ctz(mask)] : 0;
+#else
+			for (unsigned i = 0; i != n16->count_; ++i) {
+				if (n16->keys_[i] == c) {
+					return &n16->children_[i];
+				}
+			}
+			return 0;
+#endif
+		}
+		case node48_type: {
+			node48* n48 = static_cast<node48*>(n);
+			return n48->index_[c] ? &n48->children_[n48->index_[c] - 1] : 0;
+		}
+		default: {
+			node256* n256 = static_cast<node256*>(n);
+			return n256->children_[c] ? &n256->children_[c] : 0;
+		}
+		}
+	}
+
+	/**
+	 * @brief Adds child under byte c to n, which is stored at ref, growing n if it is full.
+	 */
+	void add_child(void** ref, inner* n, unsigned char c, void* child)
+	{
+		switch (n->type_) {
+		case node4_type: {
+			node4* n4 = static_cast<node4*>(n);
+			if (n4->count_ < 4) {
+				insert_sorted(n4->keys_, n4->children_, n4->count_, c, child);
+				return;
+			}
+			node16* n16 = new_node<node16>(node16_type);
+			copy_header(n16, n4);
+			memcpy(n16->keys_, n4->keys_, sizeof(n4->keys_));
+			memcpy(n16->children_, n4->children_, sizeof(n4->children_));
+			insert_sorted(n16->keys_, n16->children_, n16->count_, c, child);
+			*ref = n16;
+			free_node(n4);
+			return;
+		}
+		case node16_type: {
+			node16* n16 = static_cast<node16*>(n);
+			if (n16->count_ < 16) {
+				insert_sorted(n16->keys_, n16->children_, n16->count_, c, child);
+				return;
+			}
+			node48* n48 = new_node<node48>(node48_type);
+			copy_header(n48, n16);
+			for (unsigned i = 0; i != 16; ++i) {
+				n48->children_[i] = n16->children_[i];
+				n48->index_[n16->keys_[i]] = static_cast<unsigned char>(i + 1);
+			}
+			n48->children_[16] = child;
+			n48->index_[c] = 17;
+			++n48->count_;
+			*ref = n48;
+			free_node(n16);
+			return;
+		}
+		case node48_type: {
+			node48* n48 = static_cast<node48*>(n);
+			if (n48->count_ < 48) {
+				unsigned pos = 0;
+				while (n48->children_[pos]) {
+					++pos;
+				}
+				n48->children_[pos] = child;
+				n48->index_[c] = static_cast<unsigned char>(pos + 1);
+				++n48->count_;
+				return;
+			}
+			node256* n256 = new_node<node256>(node256_type);
+			copy_header(n256, n48);
+			for (unsigned b = 0; b != 256; ++b) {
+				if (n48->index_[b]) {
+					n256->children_[b] = n48->children_[n48->index_[b] - 1];
+				}
+			}
+			n256->children_[c] = child;
+			++n256->count_;
+			*ref = n256;
+			free_node(n48);
+			return;
+		}
+		default: {
+			node256* n256 = static_cast<node256*>(n);
+			n256->children_[c] = child;
+			++n256->count_;
+			return;
+		}
+		}
+	}
+
+	static void insert_sorted(unsigned char* keys, void** children, uint16_t& count, unsigned char c, void* child)
+	{
+		unsigned i = 0;
+		while (i != count && keys[i] < c) {
+			++i;
+		}
+		memmove(keys + i + 1, keys + i, count - i);
+		memmove(children + i + 1, children + i, (count - i) * sizeof(void*));
+		keys[i] = c;
+		children[i] = child;
+		++count;
+	}
+
+	static void remove_sorted(unsigned char* keys, void** children, uint16_t& count, void** slot)
+	{
+		unsigned i = static_cast<unsigned>(slot - children);
+		memmove(keys + i, keys + i + 1, count - i - 1);
+		memmove(children + i, children + i + 1, (count - i - 1) * sizeof(void*));
+		--count;
+	}
+
+	static void remove_child(inner* n, unsigned char c, void** slot)
+	{
+		switch (n->type_) {
+		case node4_type:
+			remove_sorted(static_cast<node4*>(n)->keys_, static_cast<node4*>(n)->children_, n->count_, slot);
+			break;
+		case node16_type:
+			remove_sorted(static_cast<node16*>(n)->keys_, static_cast<node16*>(n)->children_, n->count_, slot);
+			break;
+		case node48_type: {
+			node48* n48 = static_cast<node48*>(n);
+			n48->children_[n48->index_[c] - 1] = 0;
+			n48->index_[c] = 0;
+			--n48->count_;
+			break;
+		}
+		default:
+			static_cast<node256*>(n)->children_[c] = 0;
+			--n->count_;
+			break;
+		}
+	}
+
+	/**
+	 * @brief Shrinks or collapses the node stored at ref after a removal.
+	 * @param depth depth of the node, not counting its prefix
+	 *
+	 * Shrinking to a smaller node type is skipped if the allocation fails;
+	 * the larger node stays valid.
+	 */
+	void shrink(void** ref, size_t depth)
+	{
+		inner* n = to_inner(*ref);
+		try {
+			switch (n->type_) {
+			case node4_type:
+				if (n->count_ + (n->terminal_ ? 1 : 0) <= 1) {
+					collapse(ref, static_cast<node4*>(n), depth);
+				}
+				break;
+			case node16_type:
+				if (n->count_ <= 3) {
+					node16* n16 = static_cast<node16*>(n);
+					node4* n4 = new_node<node4>(node4_type);
+					copy_header(n4, n16);
+					memcpy(n4->keys_, n16->keys_, n16->count_);
+					memcpy(n4->children_, n16->children_, n16->count_ * sizeof(void*));
+					*ref = n4;
+					free_node(n16);
+				}
+				break;
+			case node48_type:
+				if (n->count_ <= 12) {
+					node48* n48 = static_cast<node48*>(n);
+					node16* n16 = new_node<node16>(node16_type);
+					copy_header(n16, n48);
+					n16->count_ = 0;
+					for (unsigned b = 0; b != 256; ++b) {
+						if (n48->index_[b]) {
+							n16->keys_[n16->count_] = static_cast<unsigned char>(b);
+							n16->children_[n16->count_++] = n48->children_[n48->index_[b] - 1];
+						}
+					}
+					*ref = n16;
+					free_node(n48);
+				}
+				break;
+			default:
+				if (n->count_ <= 37) {
+					node256* n256 = static_cast<node256*>(n);
+					node48* n48 = new_node<node48>(node48_type);
+					copy_header(n48, n256);
+					unsigned pos = 0;
+					for (unsigned b = 0; b != 256; ++b) {
+						if (n256->children_[b]) {
+							n48->children_[pos] = n256->children_[b];
+							n48->index_[b] = static_cast<unsigned char>(++pos);
+						}
+					}
+					*ref = n48;
+					free_node(n256);
+				}
+				break;
+			}
+		} catch (...) {
+		}
+	}
+
+	/**
+	 * @brief Replaces a node4 left with a single entry by that entry.
+	 *
+	 * A single inner child absorbs the node's prefix and the byte leading
+	 * to it into its own prefix.
+	 */
+	void collapse(void** ref, node4* n, size_t depth)
+	{
+		if (n->terminal_) {
+			*ref = from_leaf(n->terminal_);
+		} else if (n->count_ == 0) {
+			*ref = 0;
+		} else if (is_leaf(n->children_[0])) {
+			*ref = n->children_[0];
+		} else {
+			inner* child = to_inner(n->children_[0]);
+			child->prefixLen_ += n->prefixLen_ + 1;
+			memcpy(child->prefix_, leaf_key(minimum(child)) + depth, min_size(child->prefixLen_, max_prefix));
+			*ref = child;
+		}
+		free_node(n);
+	}
+
+	/**
+	 * @return the element with the smallest key under p
+	 */
+	static leaf* minimum(void* p)
+	{
+		while (!is_leaf(p)) {
+			inner* n = to_inner(p);
+			if (n->terminal_) {
+				return n->terminal_;
+			}
+			switch (n->type_) {
+			case node4_type:
+				p = static_cast<node4*>(n)->children_[0];
+				break;
+			case node16_type:
+				p = static_cast<node16*>(n)->children_[0];
+				break;
+			case node48_type: {
+				node48* n48 = static_cast<node48*>(n);
+				unsigned b = 0;
+				while (!n48->index_[b]) {
+					++b;
+				}
+				p = n48->children_[n48->index_[b] - 1];
+				break;
+			}
+			default: {
+				node256* n256 = static_cast<node256*>(n);
+				unsigned b = 0;
+				while (!n256->children_[b]) {
+					++b;
+				}
+				p = n256->children_[b];
+				break;
+			}
+			}
+		}
+		return to_leaf(p);
+	}
+
+	/**
+	 * @return the element with the largest key under p
+	 */
+	static leaf* maximum(void* p)
+	{
+		while (!is_leaf(p)) {
+			inner* n = to_inner(p);
+			void* child = child_before(n, 256);
+			if (!child) {
+				return n->terminal_;
+			}
+			p = child;
+		}
+		return to_leaf(p);
+	}
+
+	/**
+	 * @return the first child of n whose byte is greater than c, or 0
+	 */
+	static void* child_after(inner* n, int c)
+	{
+		switch (n->type_) {
+		case node4_type: {
+			node4* n4 = static_cast<node4*>(n);
+			for (unsigned i = 0; i != n4->count_; ++i) {
+				if (n4->keys_[i] > c) {
+					return n4->children_[i];
+				}
+			}
+			return 0;
+		}
+		case node16_type: {
+			node16* n16 = static_cast<node16*>(n);
+			for (unsigned i = 0; i != n16->count_; ++i) {
+				if (n16->keys_[i] > c) {
+					return n16->children_[i];
+				}
+			}
+			return 0;
+		}
+		case node48_type: {
+			node48* n48 = static_cast<node48*>(n);
+			for (int b = c + 1; b < 256; ++b) {
+				if (n48->index_[b]) {
+					return n48->children_[n48->index_[b] - 1];
+				}
+			}
+			return 0;
+		}
+		default: {
+			node256* n256 = static_cast<node256*>(n);
+			for (int b = c + 1; b < 256; ++b) {
+				if (n256->children_[b]) {
+					return n256->children_[b];
+				}
+			}
+			return 0;
+		}
+		}
+	}
+
+	/**
+	 * @return the last child of n whose byte is less than c, or 0
+	 */
+	static void* child_before(inner* n, int c)
+	{
+		switch (n->type_) {
+		case node4_type: {
+			node4* n4 = static_cast<node4*>(n);
+			for (unsigned i = n4->count_; i != 0; --i) {
+				if (n4->keys_[i - 1] < c) {
+					return n4->children_[i - 1];
+				}
+			}
+			return 0;
+		}
+		case node16_type: {
+			node16* n16 = static_cast<node16*>(n);
+			for (unsigned i = n16->count_; i != 0; --i) {
+				if (n16->keys_[i - 1] < c) {
+					return n16->children_[i - 1];
+				}
+			}
+			return 0;
+		}
+		case node48_type: {
+			node48* n48 = static_cast<node48*>(n);
+			for (int b = c - 1; b >= 0; --b) {
+				if (n48->index_[b]) {
+					return n48->children_[n48->index_[b] - 1];
+				}
+			}
+			return 0;
+		}
+		default: {
+			node256* n256 = static_cast<node256*>(n);
+			for (int b = c - 1; b >= 0; --b) {
+				if (n256->children_[b]) {
+					return n256->children_[b];
+				}
+			}
+			return 0;
+		}
+		}
+	}
+
+	// lookup
+
+	static int compare_keys(const unsigned char* a, size_t alen, const unsigned char* b, size_t blen)
+	{
+		size_t n = min_size(alen, blen);
+		int r = n ? memcmp(a, b, n) : 0;
+		if (r) {
+			return r;
+		}
+		return alen < blen ? -1 : (alen == blen ? 0 : 1);
+	}
+
+	/**
+	 * @brief Orders the keys under n against key, whose first depth bytes they all share.
+	 * @return <0 or >0 if every key under n orders before or after key, 0 if key runs through n's whole prefix
+	 */
+	static int compare_prefix(inner* n, const unsigned char* key, size_t len, size_t depth)
+	{
+		if (n->prefixLen_ == 0) {
+			return 0;
+		}
+		const unsigned char* prefix = n->prefixLen_ <= max_prefix ? n->prefix_ : leaf_key(minimum(n)) + depth;
+		size_t common = min_size(n->prefixLen_, len - depth);
+		int r = memcmp(prefix, key + depth, common);
+		if (r) {
+			return r;
+		}
+		// a key ending inside the prefix orders before every key under n
+		return common < n->prefixLen_ ? 1 : 0;
+	}
+
+	/**
+	 * @return the element under p with the smallest key greater than key, or not less than it unless strict; 0 if none
+	 */
+	static leaf* seek_after(void* p, const unsigned char* key, size_t len, size_t depth, bool strict)
+	{
+		if (is_leaf(p)) {
+			leaf* l = to_leaf(p);
+			int r = compare_keys(leaf_key(l), leaf_key_size(l), key, len);
+			return (r > 0 || (r == 0 && !strict)) ? l : 0;
+		}
+		inner* n = to_inner(p);
+		int r = compare_prefix(n, key, len, depth);
+		if (r) {
+			return r > 0 ? minimum(n) : 0;
+		}
+		depth += n->prefixLen_;
+		if (depth == len) {
+			// the terminal holds key itself, every child a longer key
+			if (n->terminal_ && !strict) {
+				return n->terminal_;
+			}
+			void* first = child_after(n, -1);
+			return first ? minimum(first) : 0;
+		}
+		void** child = find_child(n, key[depth]);
+		if (child) {
+			leaf* l = seek_after(*child, key, len, depth + 1, strict);
+			if (l) {
+				return l;
+			}
+		}
+		void* next = child_after(n, key[depth]);
+		return next ? minimum(next) : 0;
+	}
+
+	/**
+	 * @return the element under p with the largest key less than key, or 0
+	 */
+	static leaf* seek_before(void* p, const unsigned char* key, size_t len, size_t depth)
+	{
+		if (is_leaf(p)) {
+			leaf* l = to_leaf(p);
+			return compare_keys(leaf_key(l), leaf_key_size(l), key, len) < 0 ? l : 0;
+		}
+		inner* n = to_inner(p);
+		int r = compare_prefix(n, key, len, depth);
+		if (r) {
+			return r < 0 ? maximum(n) : 0;
+		}
+		depth += n->prefixLen_;
+		if (depth == len) {
+			return 0;
+		}
+		void** child = find_child(n, key[depth]);
+		if (child) {
+			leaf* l = seek_before(*child, key, len, depth + 1);
+			if (l) {
+				return l;
+			}
+		}
+		void* prev = child_before(n, key[depth]);
+		// the terminal's key is a proper prefix of key, so it comes before every child
+		return prev ? maximum(prev) : n->terminal_;
+	}
+
+	leaf* bound_leaf(const unsigned char* key, size_t len, bool strict) const
+	{
+		return root_ ? seek_after(root_, key, len, 0, strict) : 0;
+	}
+
+	leaf* prev_leaf(const unsigned char* key, size_t len) const
+	{
+		return root_ ? seek_before(root_, key, len, 0) : 0;
+	}
+
+	/**
+	 * @brief Checks the stored bytes of n's prefix against key at depth.
+	 *
+	 * Bytes of long prefixes that are not stored are skipped; callers compare
+	 * the whole key at the leaf.
+	 */
+	static bool prefix_matches(const inner* n, const unsigned char* key, size_t len, size_t depth)
+	{
+		return len - depth >= n->prefixLen_
+				&& memcmp(n->prefix_, key + depth, min_size(n->prefixLen_, max_prefix)) == 0;
+	}
+
+	/**
+	 * @return length of the common part of n's prefix and key from depth
+	 */
+	static size_t prefix_mismatch(inner* n, const unsigned char* key, size_t len, size_t depth)
+	{
+		size_t limit = min_size(min_size(n->prefixLen_, max_prefix), len - depth);
+		size_t i = 0;
+		for (; i != limit; ++i) {
+			if (n->prefix_[i] != key[depth + i]) {
+				return i;
+			}
+		}
+		if (n->prefixLen_ > max_prefix && i == max_prefix) {
+			// the rest of the prefix is only kept in the leaves
+			const unsigned char* leafKey = leaf_key(minimum(n));
+			limit = min_size(n->prefixLen_, len - depth);
+			for (; i != limit; ++i) {
+				if (leafKey[depth + i] != key[depth + i]) {
+					return i;
+				}
+			}
+		}
+		return i;
+	}
+
+	leaf* find_leaf(const unsigned char* key, size_t len) const
+	{
+		void* p = root_;
+		size_t depth = 0;
+		while (p) {
+			if (is_leaf(p)) {
+				leaf* l = to_leaf(p);
+				return leaf_matches(l, key, len) ? l : 0;
+			}
+			inner* n = to_inner(p);
+			if (!prefix_matches(n, key, len, depth)) {
+				return 0;
+			}
+			depth += n->prefixLen_;
+			if (depth == len) {
+				leaf* l = n->terminal_;
+				return (l && leaf_matches(l, key, len)) ? l : 0;
+			}
+			void** child = find_child(n, key[depth]);
+			if (!child) {
+				return 0;
+			}
+			p = *child;
+			++depth;
+		}
+		return 0;
+	}
+
+	/**
+	 * @return the subtree holding exactly the keys that start with prefix, or 0
+	 */
+	void* find_prefix(const unsigned char* prefix, size_t len) const
+	{
+		void* p = root_;
+		size_t depth = 0;
+		while (p) {
+			if (is_leaf(p)) {
+				return leaf_has_prefix(to_leaf(p), prefix, len) ? p : 0;
+			}
+			inner* n = to_inner(p);
+			size_t stored = min_size(min_size(n->prefixLen_, max_prefix), len - depth);
+			if (memcmp(n->prefix_, prefix + depth, stored) != 0) {
+				return 0;
+			}
+			if (depth + n->prefixLen_ >= len) {
+				// every key below n shares the query prefix if any one of them does
+				return leaf_has_prefix(minimum(n), prefix, len) ? p : 0;
+			}
+			depth += n->prefixLen_;
+			void** child = find_child(n, prefix[depth]);
+			if (!child) {
+				return 0;
+			}
+			p = *child;
+			++depth;
+		}
+		return 0;
+	}
+
+	template<typename _Function>
+	static void walk(void* p, _Function& f)
+	{
+		if (is_leaf(p)) {
+			f(to_leaf(p)->value_);
+			return;
+		}
+		inner* n = to_inner(p);
+		if (n->terminal_) {
+			f(n->terminal_->value_);
+		}
+		for_each_child(n, [&f](unsigned char, void* child) { walk(child, f); });
+	}
+
+	// modifiers
+
+	template<typename... _Args>
+	std::pair<leaf*, bool> emplace_leaf(_Args&&... args)
+	{
+		leaf_allocator a(alloc_);
+		leaf* l = leaf_alloc_traits::allocate(a, 1);
+		try {
+			::new (static_cast<void*>(l)) leaf(std::forward<_Args>(args)...);
+		} catch (...) {
+			leaf_alloc_traits::deallocate(a, l, 1);
+			throw;
+		}
+
+		std::pair<leaf*, bool> ret;
+		try {
+			ret = insert_rec(&root_, l, leaf_key(l), leaf_key_size(l), 0);
+		} catch (...) {
+			l->~leaf();
+			leaf_alloc_traits::deallocate(a, l, 1);
+			throw;
+		}
+		if (ret.second) {
+			link_back(l);
+			++size_;
+		} else {
+			l->~leaf();
+			leaf_alloc_traits::deallocate(a, l, 1);
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief Stores leaf l, whose key ends or branches at depth, into a new node4.
+	 */
+	static void place(node4* n, leaf* l, const unsigned char* key, size_t len, size_t depth)
+	{
+		if (len == depth) {
+			n->terminal_ = l;
+		} else {
+			insert_sorted(n->keys_, n->children_, n->count_, key[depth], from_leaf(l));
+		}
+	}
+
+	/**
+	 * @return the leaf holding key, and true if it is newLeaf
+	 */
+	std::pair<leaf*, bool> insert_rec(void** ref, leaf* newLeaf, const unsigned char* key, size_t len, size_t depth)
+	{
+		for (;;) {
+			void* p = *ref;
+			if (!p) {
+				*ref = from_leaf(newLeaf);
+				return std::make_pair(newLeaf, true);
+			}
+
+			if (is_leaf(p)) {
+				leaf* l = to_leaf(p);
+				if (leaf_matches(l, key, len)) {
+					return std::make_pair(l, false);
+				}
+				// split the leaf: a node4 holds the common part of both keys
+				const unsigned char* leafKey = leaf_key(l);
+				size_t leafLen = leaf_key_size(l);
+				size_t limit = min_size(leafLen, len);
+				size_t i = depth;
+				while (i != limit && leafKey[i] == key[i]) {
+					++i;
+				}
+				node4* n = new_node<node4>(node4_type);
+				n->prefixLen_ = static_cast<uint32_t>(i - depth);
+				memcpy(n->prefix_, key + depth, min_size(n->prefixLen_, max_prefix));
+				place(n, l, leafKey, leafLen, i);
+				place(n, newLeaf, key, len, i);
+				*ref = n;
+				return std::make_pair(newLeaf, true);
+			}
+
+			inner* n = to_inner(p);
+			if (n->prefixLen_) {
+				size_t mismatch = prefix_mismatch(n, key, len, depth);
+				if (mismatch != n->prefixLen_) {
+					// split the prefix: a node4 takes its common part
+					node4* parent = new_node<node4>(node4_type);
+					parent->prefixLen_ = static_cast<uint32_t>(mismatch);
+					memcpy(parent->prefix_, n->prefix_, min_size(mismatch, max_prefix));
+					unsigned char c;
+					if (n->prefixLen_ <= max_prefix) {
+						c = n->prefix_[mismatch];
+						n->prefixLen_ -= static_cast<uint32_t>(mismatch + 1);
+						memmove(n->prefix_, n->prefix_ + mismatch + 1, n->prefixLen_);
+					} else {
+						const unsigned char* leafKey = leaf_key(minimum(n));
+						c = leafKey[depth + mismatch];
+						n->prefixLen_ -= static_cast<uint32_t>(mismatch + 1);
+						memcpy(n->prefix_, leafKey + depth + mismatch + 1, min_size(n->prefixLen_, max_prefix));
+					}
+					insert_sorted(parent->keys_, parent->children_, parent->count_, c, n);
+					place(parent, newLeaf, key, len, depth + mismatch);
+					*ref = parent;
+					return std::make_pair(newLeaf, true);
+				}
+				depth += n->prefixLen_;
+			}
+
+			if (depth == len) {
+				if (n->terminal_) {
+					return std::make_pair(n->terminal_, false);
+				}
+				n->terminal_ = newLeaf;
+				return std::make_pair(newLeaf, true);
+			}
+
+			void** child = find_child(n, key[depth]);
+			if (!child) {
+				add_child(ref, n, key[depth], from_leaf(newLeaf));
+				return std::make_pair(newLeaf, true);
+			}
+			ref = child;
+			++depth;
+		}
+	}
+
+	/**
+	 * @return the leaf holding key after taking it out of the tree, or 0
+	 */
+	leaf* erase_rec(void** ref, const unsigned char* key, size_t len, size_t depth)
+	{
+		void* p = *ref;
+		if (!p) {
+			return 0;
+		}
+		if (is_leaf(p)) {
+			leaf* l = to_leaf(p);
+			if (!leaf_matches(l, key, len)) {
+				return 0;
+			}
+			*ref = 0;
+			return l;
+		}
+
+		inner* n = to_inner(p);
+		if (!prefix_matches(n, key, len, depth)) {
+			return 0;
+		}
+		size_t nodeDepth = depth;
+		depth += n->prefixLen_;
+
+		leaf* l;
+		if (depth == len) {
+			l = n->terminal_;
+			if (!l || !leaf_matches(l, key, len)) {
+				return 0;
+			}
+			n->terminal_ = 0;
+		} else {
+			void** child = find_child(n, key[depth]);
+			if (!child) {
+				return 0;
+			}
+			if (!is_leaf(*child)) {
+				// an inner child never becomes empty: it collapses into its last entry instead
+				return erase_rec(child, key, len, depth + 1);
+			}
+			l = to_leaf(*child);
+			if (!leaf_matches(l, key, len)) {
+				return 0;
+			}
+			remove_child(n, key[depth], child);
+		}
+		shrink(ref, nodeDepth);
+		return l;
+	}
+
+	void destroy_leaf(leaf* l)
+	{
+		unlink(l);
+		--size_;
+		l->~leaf();
+		leaf_allocator a(alloc_);
+		leaf_alloc_traits::deallocate(a, l, 1);
+	}
+
+private:
+	void*			root_;
+	size_type		size_;
+	link_node		header_;	// sentinel of the link list
+	allocator_type	alloc_;
+};
+
+template<typename _Key, typename _Tp, typename _Alloc>
+inline void swap(art_map<_Key, _Tp, _Alloc>& x, art_map<_Key, _Tp, _Alloc>& y)
+{
+	x.swap(y);
+}
+
+}
+
+#endif // LIBANT_CONTAINER_ART_MAP_H_
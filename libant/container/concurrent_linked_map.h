@@ -0,0 +1,238 @@
+/**
+ * @file container/concurrent_linked_map.h
+ * @brief Read-mostly concurrent linked_map.
+ */
+
+#ifndef LIBANT_CONTAINER_CONCURRENT_LINKED_MAP_H_
+#define LIBANT_CONTAINER_CONCURRENT_LINKED_MAP_H_
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "internal/epoch.h"
+#include "linked_map.h"
+
+namespace ant {
+
+/**
+ * @brief A linked_map for read-mostly workloads shared between threads.
+ *
+ * Readers never block: every read runs against an immutable snapshot of the
+ * map inside an epoch read-side critical section, which costs two stores and
+ * no shared writes. Replaced snapshots are retired and freed once no reader
+ * can still be looking at them.
+ *
+ * Writes are serialized by a single mutex, one writer at a time. Each write
+ * copies the whole current snapshot, applies its change to the copy and
+ * publishes it with one atomic exchange. A write therefore costs O(n) time
+ * and n node allocations however small the change, and the old snapshot
+ * stays allocated until the readers that may see it are gone. This suits
+ * maps that are read far more often than written; batch related changes
+ * with update(), which pays for one copy. bench/concurrent_bench.cc
+ * measures both the read scaling and the cost of a write.
+ */
+template<typename _Key, typename _Tp, typename _Compare = std::less<_Key>,
+			typename _Alloc = std::allocator<std::pair<const _Key, _Tp> > >
+class concurrent_linked_map {
+public:
+	typedef linked_map<_Key, _Tp, _Compare, _Alloc> map_type;
+	typedef typename map_type::key_type key_type;
+	typedef typename map_type::mapped_type mapped_type;
+	typedef typename map_type::value_type value_type;
+	typedef typename map_type::size_type size_type;
+
+public:
+	concurrent_linked_map() : map_(new map_type)
+	{
+	}
+
+	explicit concurrent_linked_map(const map_type& m) : map_(new map_type(m))
+	{
+	}
+
+	/**
+	 * No reader or writer may be running when the map is destroyed.
+	 */
+	~concurrent_linked_map()
+	{
+		for (auto& r : retired_) {
+			delete r.second;
+		}
+		delete map_.load(std::memory_order_relaxed);
+	}
+
+	// readers
+
+	/**
+	 * @brief Copies the value mapped to key into value.
+	 * @return true if key is present
+	 */
+	bool find(const key_type& key, mapped_type& value) const
+	{
+		epoch_guard guard;
+		const map_type* m = map_.load(std::memory_order_seq_cst);
+		auto it = m->find(key);
+		if (it == m->end()) {
+			return false;
+		}
+		value = it->second;
+		return true;
+	}
+
+	bool contains(const key_type& key) const
+	{
+		epoch_guard guard;
+		return map_.load(std::memory_order_seq_cst)->count(key) != 0;
+	}
+
+	size_type size() const
+	{
+		epoch_guard guard;
+		return map_.load(std::memory_order_seq_cst)->size();
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * @brief Calls fn(const map_type&) on the current snapshot.
+	 *
+	 * The snapshot stays valid until fn returns; references into it must not escape fn.
+	 */
+	template<typename _Fn>
+	void read(_Fn fn) const
+	{
+		epoch_guard guard;
+		fn(static_cast<const map_type&>(*map_.load(std::memory_order_seq_cst)));
+	}
+
+	/**
+	 * @return a private copy of the current snapshot
+	 */
+	map_type snapshot() const
+	{
+		epoch_guard guard;
+		return *map_.load(std::memory_order_seq_cst);
+	}
+
+	// writers
+
+	/**
+	 * @return true if inserted, false if key already exists
+	 */
+	bool insert(const value_type& value)
+	{
+		std::lock_guard<std::mutex> lock(writeLock_);
+		const map_type* cur = map_.load(std::memory_order_relaxed);
+		if (cur->count(value.first)) {
+			return false;
+		}
+		map_type* m = new map_type(*cur);
+		m->insert(value);
+		publish(m);
+		return true;
+	}
+
+	/**
+	 * @brief Inserts key or overwrites the value mapped to it. An overwritten key keeps its link position.
+	 */
+	void assign(const key_type& key, const mapped_type& value)
+	{
+		std::lock_guard<std::mutex> lock(writeLock_);
+		map_type* m = new map_type(*map_.load(std::memory_order_relaxed));
+		(*m)[key] = value;
+		publish(m);
+	}
+
+	/**
+	 * @return number of elements erased
+	 */
+	size_type erase(const key_type& key)
+	{
+		std::lock_guard<std::mutex> lock(writeLock_);
+		const map_type* cur = map_.load(std::memory_order_relaxed);
+		if (!cur->count(key)) {
+			return 0;
+		}
+		map_type* m = new map_type(*cur);
+		m->erase(key);
+		publish(m);
+		return 1;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(writeLock_);
+		publish(new map_type);
+	}
+
+	/**
+	 * @brief Applies fn(map_type&) to a copy of the current snapshot and publishes the result.
+	 *
+	 * All changes made by fn become visible to readers at once. If fn throws,
+	 * nothing is published.
+	 */
+	template<typename _Fn>
+	void update(_Fn fn)
+	{
+		std::lock_guard<std::mutex> lock(writeLock_);
+		map_type* m = new map_type(*map_.load(std::memory_order_relaxed));
+		try {
+			fn(*m);
+		} catch (...) {
+			delete m;
+			throw;
+		}
+		publish(m);
+	}
+
+	/**
+	 * @brief Frees the retired snapshots no reader can reach any more.
+	 *
+	 * Writers reclaim on their own; call this to release memory early when
+	 * writes have stopped.
+	 */
+	void reclaim()
+	{
+		std::lock_guard<std::mutex> lock(writeLock_);
+		reclaim_locked();
+	}
+
+private:
+	concurrent_linked_map(const concurrent_linked_map&);
+	concurrent_linked_map& operator=(const concurrent_linked_map&);
+
+	void publish(map_type* m)
+	{
+		const map_type* old = map_.exchange(m, std::memory_order_seq_cst);
+		retired_.push_back(std::make_pair(epoch_domain::instance().advance(), old));
+		reclaim_locked();
+	}
+
+	void reclaim_locked()
+	{
+		uint64_t minActive = epoch_domain::instance().min_active();
+		size_t kept = 0;
+		for (size_t i = 0; i != retired_.size(); ++i) {
+			if (retired_[i].first < minActive) {
+				delete retired_[i].second;
+			} else {
+				retired_[kept++] = retired_[i];
+			}
+		}
+		retired_.resize(kept);
+	}
+
+private:
+	std::atomic<map_type*>								map_;
+	std::mutex											writeLock_;
+	std::vector<std::pair<uint64_t, const map_type*> >	retired_;
+};
+
+}
+
+#endif // LIBANT_CONTAINER_CONCURRENT_LINKED_MAP_H_
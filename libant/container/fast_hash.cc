@@ -0,0 +1,272 @@
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#endif
+
+#include "small_string.h"
+
+// hash_bytes_fast follows wyhash for keys up to 128 bytes and the XXH3
+// accumulator for longer ones: eight 64-bit lanes, each taking the sum of
+// its neighbour's input word and the product of the two 32-bit halves of
+// its own word xored with the secret. That is two vector instructions per
+// 16 bytes on SSE2 and NEON and per 32 bytes on AVX2, and every kernel
+// computes the same lanes, so the hash doesn't depend on the CPU.
+
+namespace ant {
+
+namespace {
+
+const uint64_t secret[40] = {
+	0x91d8e1d299288a4eULL, 0xc2a02ef2e11c8952ULL, 0x6faf6dacbfe182c8ULL, 0xe7e726013bc4756bULL,
+	0x50ea4ce478a3ab5aULL, 0xc59e96f37f83a5e5ULL, 0x31b57ff03926a0f8ULL, 0x304e49f52e0b58d0ULL,
+	0x8ef451e35a8fc7e5ULL, 0x29163007561a389fULL, 0xe9dd4d59f7a86fd4ULL, 0xb2af8647724c208cULL,
+	0xc65cc200ef621155ULL, 0xee481bc47f8cca03ULL, 0xfa582c81181c44eeULL, 0x1c187262e63463e0ULL,
+	0x26fde52cbbe552cdULL, 0x29009a3aa5eb0c59ULL, 0xcbd063cf1e73d2dbULL, 0x2527c21f81a55329ULL,
+	0x239b738d6e5a6ccdULL, 0xb73475bf1bf0abf3ULL, 0xf75b4fbe4e9377b2ULL, 0x3809855ae64a06e6ULL,
+	0xab9a28d9e7d834cdULL, 0x4bcecaa6817835abULL, 0x48e7d7690e21e473ULL, 0x8f50cc4849c522d6ULL,
+	0xfc8749af3e9cc89eULL, 0xb412d34b43b7f876ULL, 0x951ff1f4c7ef418fULL, 0x511b8f137e1bd66cULL,
+	0x9cf7bb86520a8195ULL, 0xa568d23701184e21ULL, 0xee0637a7ff7f0e4eULL, 0xc4de6ba8f466f1e1ULL,
+	0x02b221b61c725d0eULL, 0x317fa8d27bb164ceULL, 0x1d798950aab69c66ULL, 0x40405b26814741dbULL,
+};
+
+// Where the long-key stages read the secret, in words: stripe s of a block
+// uses secret + s, the last stripe last_stripe_key, and so on.
+const size_t stripe_bytes = 64;
+const size_t block_stripes = 16;
+const size_t last_stripe_key = 11;
+const size_t scramble_key = 24;
+const size_t merge_key = 32;
+
+const uint64_t prime0 = 0xa0761d6478bd642fULL;
+const uint64_t prime1 = 0xe7037ed1a0b428dbULL;
+const uint64_t prime32 = 0x9e3779b1ULL;
+
+inline uint64_t read64(const unsigned char* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+inline uint64_t read32(const unsigned char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+
+// 64x64->128 multiply, folded.
+inline uint64_t mix(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = static_cast<__uint128_t>(a) * b;
+	return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+	uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	return lo ^ hi;
+#endif
+}
+
+uint64_t hash_short(const unsigned char* p, size_t len, uint64_t seed)
+{
+	seed ^= mix(seed ^ prime0, prime1);
+	uint64_t a, b;
+	if (len <= 16) {
+		if (len >= 4) {
+			const size_t off = (len >> 3) << 2;
+			a = (read32(p) << 32) | read32(p + off);
+			b = (read32(p + len - 4) << 32) | read32(p + len - 4 - off);
+		} else if (len > 0) {
+			a = (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+		for (; i > 16; i -= 16, p += 16) {
+			seed = mix(read64(p) ^ prime1, read64(p + 8) ^ seed);
+		}
+		a = read64(p + i - 16);
+		b = read64(p + i - 8);
+	}
+	return mix(prime1 ^ len, mix(a ^ prime1, b ^ seed));
+}
+
+typedef void (*accumulate_fn)(uint64_t* acc, const unsigned char* p, size_t stripes, const uint64_t* key);
+
+void accumulate_scalar(uint64_t* acc, const unsigned char* p, size_t stripes, const uint64_t* key)
+{
+	for (size_t s = 0; s != stripes; ++s, p += stripe_bytes) {
+		for (size_t i = 0; i != 8; ++i) {
+			const uint64_t d = read64(p + 8 * i);
+			const uint64_t k = d ^ key[s + i];
+			acc[i ^ 1] += d;
+			acc[i] += (k & 0xffffffff) * (k >> 32);
+		}
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+void accumulate_sse2(uint64_t* acc, const unsigned char* p, size_t stripes, const uint64_t* key)
+{
+	__m128i* a = reinterpret_cast<__m128i*>(acc);
+	__m128i a0 = _mm_loadu_si128(a), a1 = _mm_loadu_si128(a + 1), a2 = _mm_loadu_si128(a + 2),
+			a3 = _mm_loadu_si128(a + 3);
+	for (size_t s = 0; s != stripes; ++s, p += stripe_bytes) {
+		const __m128i* d = reinterpret_cast<const __m128i*>(p);
+		const __m128i* k = reinterpret_cast<const __m128i*>(key + s);
+#define LIBANT_HASH_LANE(acc, i) { \
+			__m128i dv = _mm_loadu_si128(d + i); \
+			__m128i kv = _mm_xor_si128(dv, _mm_loadu_si128(k + i)); \
+			__m128i prod = _mm_mul_epu32(kv, _mm_shuffle_epi32(kv, _MM_SHUFFLE(0, 3, 0, 1))); \
+			acc = _mm_add_epi64(acc, _mm_add_epi64(prod, _mm_shuffle_epi32(dv, _MM_SHUFFLE(1, 0, 3, 2)))); \
+		}
+		LIBANT_HASH_LANE(a0, 0)
+		LIBANT_HASH_LANE(a1, 1)
+		LIBANT_HASH_LANE(a2, 2)
+		LIBANT_HASH_LANE(a3, 3)
+#undef LIBANT_HASH_LANE
+	}
+	_mm_storeu_si128(a, a0);
+	_mm_storeu_si128(a + 1, a1);
+	_mm_storeu_si128(a + 2, a2);
+	_mm_storeu_si128(a + 3, a3);
+}
+
+__attribute__((target("avx2")))
+void accumulate_avx2(uint64_t* acc, const unsigned char* p, size_t stripes, const uint64_t* key)
+{
+	__m256i* a = reinterpret_cast<__m256i*>(acc);
+	__m256i a0 = _mm256_loadu_si256(a), a1 = _mm256_loadu_si256(a + 1);
+	for (size_t s = 0; s != stripes; ++s, p += stripe_bytes) {
+		const __m256i* d = reinterpret_cast<const __m256i*>(p);
+		const __m256i* k = reinterpret_cast<const __m256i*>(key + s);
+#define LIBANT_HASH_LANE(acc, i) { \
+			__m256i dv = _mm256_loadu_si256(d + i); \
+			__m256i kv = _mm256_xor_si256(dv, _mm256_loadu_si256(k + i)); \
+			__m256i prod = _mm256_mul_epu32(kv, _mm256_shuffle_epi32(kv, _MM_SHUFFLE(0, 3, 0, 1))); \
+			acc = _mm256_add_epi64(acc, _mm256_add_epi64(prod, _mm256_shuffle_epi32(dv, _MM_SHUFFLE(1, 0, 3, 2)))); \
+		}
+		LIBANT_HASH_LANE(a0, 0)
+		LIBANT_HASH_LANE(a1, 1)
+#undef LIBANT_HASH_LANE
+	}
+	_mm256_storeu_si256(a, a0);
+	_mm256_storeu_si256(a + 1, a1);
+}
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+void accumulate_neon(uint64_t* acc, const unsigned char* p, size_t stripes, const uint64_t* key)
+{
+	uint64x2_t a[4];
+	for (int i = 0; i != 4; ++i) {
+		a[i] = vld1q_u64(acc + 2 * i);
+	}
+	for (size_t s = 0; s != stripes; ++s, p += stripe_bytes) {
+		for (int i = 0; i != 4; ++i) {
+			uint64x2_t dv = vreinterpretq_u64_u8(vld1q_u8(p + 16 * i));
+			uint64x2_t kv = veorq_u64(dv, vld1q_u64(key + s + 2 * i));
+			uint64x2_t prod = vmull_u32(vmovn_u64(kv), vshrn_n_u64(kv, 32));
+			a[i] = vaddq_u64(a[i], vaddq_u64(prod, vextq_u64(dv, dv, 1)));
+		}
+	}
+	for (int i = 0; i != 4; ++i) {
+		vst1q_u64(acc + 2 * i, a[i]);
+	}
+}
+#endif
+
+struct hash_kernel {
+	accumulate_fn	accumulate;
+	const char*		name;
+};
+
+hash_kernel pick_kernel()
+{
+	hash_kernel k = { accumulate_scalar, "scalar" };
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		k.accumulate = accumulate_avx2;
+		k.name = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		k.accumulate = accumulate_sse2;
+		k.name = "sse2";
+	}
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	k.accumulate = accumulate_neon;
+	k.name = "neon";
+#endif
+	return k;
+}
+
+const hash_kernel& active_kernel()
+{
+	static const hash_kernel k = pick_kernel();
+	return k;
+}
+
+uint64_t hash_long(const unsigned char* p, size_t len, uint64_t seed)
+{
+	const accumulate_fn accumulate = active_kernel().accumulate;
+	const uint64_t total = len;
+	uint64_t acc[8] = {
+		prime32 ^ seed, prime0 - seed, prime1, seed ^ secret[0],
+		prime0 + seed, prime1 ^ seed, prime32 - seed, secret[1]
+	};
+
+	const size_t block_bytes = stripe_bytes * block_stripes;
+	const unsigned char* const last = p + len - stripe_bytes;
+	for (; len > block_bytes; len -= block_bytes, p += block_bytes) {
+		accumulate(acc, p, block_stripes, secret);
+		for (size_t i = 0; i != 8; ++i) {
+			acc[i] = (acc[i] ^ (acc[i] >> 47) ^ secret[scramble_key + i]) * prime32;
+		}
+	}
+	// the rest, up to a block, then the last stripe, which may overlap it
+	accumulate(acc, p, (len - 1) / stripe_bytes, secret);
+	accumulate(acc, last, 1, secret + last_stripe_key);
+
+	uint64_t h = total * prime0;
+	for (size_t i = 0; i != 8; i += 2) {
+		h += mix(acc[i] ^ secret[merge_key + i], acc[i + 1] ^ secret[merge_key + i + 1]);
+	}
+	h ^= h >> 37;
+	h *= 0x165667919e3779f9ULL;
+	return h ^ (h >> 32);
+}
+
+}
+
+size_t hash_bytes_fast(const void* ptr, size_t len, size_t seed)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(ptr);
+	if (len <= 128) {
+		return static_cast<size_t>(hash_short(p, len, seed));
+	}
+	return static_cast<size_t>(hash_long(p, len, seed));
+}
+
+const char* hash_bytes_fast_kernel()
+{
+	return active_kernel().name;
+}
+
+}
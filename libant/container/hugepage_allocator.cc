@@ -0,0 +1,190 @@
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+#include "hugepage_allocator.h"
+
+namespace ant {
+
+namespace {
+
+const size_t kSizeClassShift = 4;
+const size_t kSizeClassAlign = size_t(1) << kSizeClassShift;
+
+inline size_t round_up(size_t n, size_t align)
+{
+	return (n + align - 1) & ~(align - 1);
+}
+
+inline size_t system_page_size()
+{
+	static const size_t pageSize = sysconf(_SC_PAGESIZE);
+	return pageSize;
+}
+
+}
+
+hugepage_arena::hugepage_arena(size_t chunkSize, page_mode mode) :
+		chunkSize_(round_up(chunkSize ? chunkSize : huge_page_size, huge_page_size)),
+		wantedMode_(mode), mode_(mode), mappedBytes_(0), cur_(0), end_(0),
+		freeLists_(max_small_size / kSizeClassAlign + 1)
+{
+}
+
+hugepage_arena::~hugepage_arena()
+{
+	for (size_t i = 0; i != chunks_.size(); ++i) {
+		munmap(chunks_[i].first, chunks_[i].second);
+	}
+	for (std::map<void*, size_t>::iterator it = large_.begin(); it != large_.end(); ++it) {
+		munmap(it->first, it->second);
+	}
+}
+
+hugepage_arena& hugepage_arena::default_arena()
+{
+	// never destroyed: containers with static storage may still release nodes during exit
+	static hugepage_arena* arena = new hugepage_arena;
+	return *arena;
+}
+
+void* hugepage_arena::allocate(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	if (bytes <= max_small_size) {
+		return allocate_small(bytes);
+	}
+
+	page_mode mode = wantedMode_;
+	size_t len = bytes;
+	void* p = map_pages(len, mode);
+	large_.insert(std::make_pair(p, len));
+	mode_ = mode;
+	return p;
+}
+
+void hugepage_arena::deallocate(void* p, size_t bytes)
+{
+	if (!p) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mtx_);
+	if (bytes <= max_small_size) {
+		free_block* blk = static_cast<free_block*>(p);
+		free_block*& head = freeLists_[round_up(bytes ? bytes : 1, kSizeClassAlign) >> kSizeClassShift];
+		blk->next_ = head;
+		head = blk;
+		return;
+	}
+
+	std::map<void*, size_t>::iterator it = large_.find(p);
+	if (it != large_.end()) {
+		munmap(it->first, it->second);
+		mappedBytes_ -= it->second;
+		large_.erase(it);
+	}
+}
+
+hugepage_arena::page_mode hugepage_arena::mode() const
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	return mode_;
+}
+
+size_t hugepage_arena::mapped_bytes() const
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	return mappedBytes_;
+}
+
+void* hugepage_arena::allocate_small(size_t bytes)
+{
+	size_t sz = round_up(bytes ? bytes : 1, kSizeClassAlign);
+	free_block*& head = freeLists_[sz >> kSizeClassShift];
+	if (head) {
+		free_block* blk = head;
+		head = blk->next_;
+		return blk;
+	}
+
+	if (size_t(end_ - cur_) < sz) {
+		// the tail of the old chunk is abandoned, it is smaller than one block
+		page_mode mode = wantedMode_;
+		size_t len = chunkSize_;
+		char* chunk = static_cast<char*>(map_pages(len, mode));
+		chunks_.push_back(std::make_pair(static_cast<void*>(chunk), len));
+		mode_ = mode;
+		cur_ = chunk;
+		end_ = chunk + len;
+	}
+
+	void* p = cur_;
+	cur_ += sz;
+	return p;
+}
+
+void* hugepage_arena::map_pages(size_t& bytes, page_mode& mode)
+{
+	if (bytes < huge_page_size) {
+		// not worth a huge page of its own
+		mode = regular;
+	}
+
+#ifdef MAP_HUGETLB
+	if (mode == hugetlb) {
+		size_t len = round_up(bytes, huge_page_size);
+		void* p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			bytes = len;
+			mappedBytes_ += len;
+			return p;
+		}
+		// no huge pages reserved in /proc/sys/vm/nr_hugepages
+	}
+#endif
+	if (mode == hugetlb) {
+		mode = transparent;
+	}
+
+	if (mode == transparent) {
+		// over-map so that the range can be trimmed to a huge page boundary,
+		// khugepaged only collapses aligned 2M ranges
+		size_t len = round_up(bytes, huge_page_size);
+		void* raw = mmap(0, len + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+		char* begin = static_cast<char*>(raw);
+		char* aligned = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(begin), huge_page_size));
+		if (aligned != begin) {
+			munmap(begin, aligned - begin);
+		}
+		size_t tail = (begin + len + huge_page_size) - (aligned + len);
+		if (tail) {
+			munmap(aligned + len, tail);
+		}
+#ifdef MADV_HUGEPAGE
+		if (madvise(aligned, len, MADV_HUGEPAGE) != 0) {
+			mode = regular;
+		}
+#else
+		mode = regular;
+#endif
+		bytes = len;
+		mappedBytes_ += len;
+		return aligned;
+	}
+
+	size_t len = round_up(bytes, system_page_size());
+	void* p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+	bytes = len;
+	mappedBytes_ += len;
+	return p;
+}
+
+}
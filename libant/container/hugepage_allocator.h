@@ -0,0 +1,181 @@
+/**
+ * @file container/hugepage_allocator.h
+ * @brief Huge-page backed node allocator for very large linked containers.
+ */
+
+#ifndef LIBANT_CONTAINER_HUGEPAGE_ALLOCATOR_H_
+#define LIBANT_CONTAINER_HUGEPAGE_ALLOCATOR_H_
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ant {
+
+/**
+ * @brief Memory arena that carves small blocks out of huge-page backed chunks.
+ *
+ * Chunks are reserved with mmap(MAP_HUGETLB). When no explicit huge pages are
+ * configured the chunk is mapped with regular pages, aligned to the huge page
+ * size and advised with madvise(MADV_HUGEPAGE) so that transparent huge pages
+ * can back it; when that is refused too the chunk simply stays on regular
+ * pages. Packing millions of tree nodes into a few 2M pages keeps the page
+ * walk of a lookup inside the TLB.
+ *
+ * Blocks up to max_small_size bytes are rounded to a 16-byte size class and
+ * recycled through per-class free lists, larger blocks get a mapping of their
+ * own. Memory of small blocks is only returned to the system when the arena
+ * is destroyed, so the arena must outlive every container using it.
+ *
+ * All members are thread safe.
+ */
+class hugepage_arena {
+public:
+	enum page_mode {
+		hugetlb,		///< explicit huge pages, MAP_HUGETLB
+		transparent,	///< regular mapping advised with MADV_HUGEPAGE
+		regular			///< regular pages only
+	};
+
+	static const size_t huge_page_size = 2 * 1024 * 1024;
+	static const size_t max_small_size = 4096;
+
+	/**
+	 * @param chunkSize bytes reserved from the system at a time, rounded up to huge_page_size
+	 * @param mode the best page mode to try; weaker modes are used as fallbacks
+	 */
+	explicit hugepage_arena(size_t chunkSize = 64 * huge_page_size, page_mode mode = hugetlb);
+	~hugepage_arena();
+
+	/**
+	 * @return the arena used by default constructed hugepage_allocators
+	 */
+	static hugepage_arena& default_arena();
+
+	/**
+	 * @return a block of at least bytes bytes aligned to 16 bytes
+	 * @throw std::bad_alloc if the system is out of memory
+	 */
+	void* allocate(size_t bytes);
+	/**
+	 * @param bytes must be the size the block was allocated with
+	 */
+	void deallocate(void* p, size_t bytes);
+
+	/**
+	 * @return the page mode the most recent mapping ended up with
+	 */
+	page_mode mode() const;
+	/**
+	 * @return total bytes currently mapped from the system
+	 */
+	size_t mapped_bytes() const;
+
+private:
+	struct free_block {
+		free_block* next_;
+	};
+
+	void* map_pages(size_t& bytes, page_mode& mode);
+	void* allocate_small(size_t bytes);
+
+private:
+	hugepage_arena(const hugepage_arena&);
+	hugepage_arena& operator=(const hugepage_arena&);
+
+private:
+	mutable std::mutex					mtx_;
+	const size_t						chunkSize_;
+	const page_mode						wantedMode_;
+	page_mode							mode_;
+	size_t								mappedBytes_;
+	char*								cur_;	// bump pointer into the newest chunk
+	char*								end_;
+	std::vector<free_block*>			freeLists_;
+	std::vector<std::pair<void*, size_t> >	chunks_;
+	std::map<void*, size_t>				large_;	// dedicated mappings and their length
+};
+
+/**
+ * @brief Allocator handing out memory from a hugepage_arena.
+ *
+ * Plug it into a linked container to put its tree nodes on huge pages:
+ *
+ *     ant::hugepage_arena arena;
+ *     typedef std::pair<const uint64_t, uint64_t> value_type;
+ *     ant::hugepage_allocator<value_type> alloc(arena);
+ *     ant::linked_map<uint64_t, uint64_t, std::less<uint64_t>, ant::hugepage_allocator<value_type> > m(alloc);
+ *
+ * Allocators compare equal when they share an arena and propagate on copy,
+ * move and swap, so containers moved between each other keep their nodes.
+ */
+template<typename _Tp>
+class hugepage_allocator {
+public:
+	typedef _Tp value_type;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	template<typename _Up>
+	struct rebind {
+		typedef hugepage_allocator<_Up> other;
+	};
+
+	hugepage_allocator() noexcept : arena_(&hugepage_arena::default_arena())
+	{
+	}
+
+	explicit hugepage_allocator(hugepage_arena& arena) noexcept : arena_(&arena)
+	{
+	}
+
+	template<typename _Up>
+	hugepage_allocator(const hugepage_allocator<_Up>& other) noexcept : arena_(other.arena())
+	{
+	}
+
+	_Tp* allocate(size_type n)
+	{
+		static_assert(alignof(_Tp) <= 16, "hugepage_allocator supports alignments up to 16 bytes");
+		if (n > size_type(-1) / sizeof(_Tp)) {
+			throw std::bad_alloc();
+		}
+		return static_cast<_Tp*>(arena_->allocate(n * sizeof(_Tp)));
+	}
+
+	void deallocate(_Tp* p, size_type n) noexcept
+	{
+		arena_->deallocate(p, n * sizeof(_Tp));
+	}
+
+	hugepage_arena* arena() const noexcept
+	{
+		return arena_;
+	}
+
+private:
+	hugepage_arena*	arena_;
+};
+
+template<typename _Tp, typename _Up>
+inline bool operator==(const hugepage_allocator<_Tp>& a, const hugepage_allocator<_Up>& b) noexcept
+{
+	return a.arena() == b.arena();
+}
+
+template<typename _Tp, typename _Up>
+inline bool operator!=(const hugepage_allocator<_Tp>& a, const hugepage_allocator<_Up>& b) noexcept
+{
+	return a.arena() != b.arena();
+}
+
+}
+
+#endif // LIBANT_CONTAINER_HUGEPAGE_ALLOCATOR_H_
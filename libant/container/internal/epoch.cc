@@ -0,0 +1,83 @@
+#include "epoch.h"
+
+#include <stdlib.h>
+
+#include <new>
+
+namespace ant {
+
+struct epoch_thread_slot {
+	epoch_thread_slot() : rec_(epoch_domain::instance().acquire_record())
+	{
+	}
+
+	~epoch_thread_slot()
+	{
+		epoch_domain::release_record(rec_);
+	}
+
+	epoch_record*	rec_;
+};
+
+epoch_domain& epoch_domain::instance()
+{
+	static epoch_domain domain;
+	return domain;
+}
+
+epoch_record* epoch_domain::local_record()
+{
+	static thread_local epoch_thread_slot slot;
+	return slot.rec_;
+}
+
+uint64_t epoch_domain::min_active() const
+{
+	uint64_t minEpoch = UINT64_MAX;
+	for (epoch_record* rec = head_.load(std::memory_order_acquire); rec; rec = rec->next_) {
+		uint64_t e = rec->epoch_.load(std::memory_order_seq_cst);
+		if (e != 0 && e < minEpoch) {
+			minEpoch = e;
+		}
+	}
+	return minEpoch;
+}
+
+epoch_record* epoch_domain::acquire_record()
+{
+	// reuse a record left behind by an exited thread first
+	for (epoch_record* rec = head_.load(std::memory_order_acquire); rec; rec = rec->next_) {
+		bool expected = false;
+		if (!rec->inUse_.load(std::memory_order_relaxed)
+				&& rec->inUse_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			return rec;
+		}
+	}
+
+#ifdef __cpp_aligned_new
+	epoch_record* rec = new epoch_record;
+#else
+	// plain new only guarantees the alignment of max_align_t before C++17
+	void* p;
+	if (posix_memalign(&p, alignof(epoch_record), sizeof(epoch_record)) != 0) {
+		throw std::bad_alloc();
+	}
+	epoch_record* rec = new (p) epoch_record;
+#endif
+	rec->epoch_.store(0, std::memory_order_relaxed);
+	rec->inUse_.store(true, std::memory_order_relaxed);
+	rec->depth_ = 0;
+	rec->next_ = head_.load(std::memory_order_relaxed);
+	while (!head_.compare_exchange_weak(rec->next_, rec, std::memory_order_release, std::memory_order_relaxed)) {
+	}
+	return rec;
+}
+
+void epoch_domain::release_record(epoch_record* rec)
+{
+	rec->depth_ = 0;
+	rec->epoch_.store(0, std::memory_order_release);
+	rec->inUse_.store(false, std::memory_order_release);
+}
+
+}
@@ -0,0 +1,129 @@
+/**
+ * @file container/internal/epoch.h
+ * @brief Epoch based memory reclamation.
+ *
+ * This is an internal header file, included by other library headers.
+ * Do not attempt to use it directly. @headername{container/concurrent_linked_map.h}
+ */
+
+#ifndef LIBANT_CONTAINER_INTERNAL_EPOCH_H_
+#define LIBANT_CONTAINER_INTERNAL_EPOCH_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace ant {
+
+/**
+ * @brief Per-thread reader slot of an epoch_domain.
+ *
+ * epoch_ holds the global epoch observed when the owner thread entered its
+ * outermost read-side critical section, or 0 while the thread is quiescent.
+ * Records are never freed: when a thread exits its record is handed over to
+ * the next thread that registers. Records are aligned to a cache line so
+ * that readers do not write to each other's lines.
+ */
+struct alignas(64) epoch_record {
+	std::atomic<uint64_t>	epoch_;
+	std::atomic<bool>		inUse_;
+	uint32_t				depth_;
+	epoch_record*			next_;
+};
+
+/**
+ * @brief Process wide epoch domain.
+ *
+ * Readers announce the epoch they start in and withdraw the announcement when
+ * they leave; both are a single store, so read-side critical sections are
+ * wait-free. Writers unlink an object, advance the epoch and may free the
+ * object once every announced epoch is newer than the one it was retired in.
+ */
+class epoch_domain {
+public:
+	static epoch_domain& instance();
+
+	/**
+	 * @return the record of the calling thread, registering it on first use
+	 */
+	static epoch_record* local_record();
+
+	void enter(epoch_record* rec)
+	{
+		if (rec->depth_++ == 0) {
+			rec->epoch_.store(global_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+		}
+	}
+
+	void leave(epoch_record* rec)
+	{
+		if (--rec->depth_ == 0) {
+			rec->epoch_.store(0, std::memory_order_release);
+		}
+	}
+
+	/**
+	 * @brief Advances the global epoch. Must be called after the retired object has been unlinked.
+	 * @return the epoch the retired object belongs to
+	 */
+	uint64_t advance()
+	{
+		return global_.fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	/**
+	 * @return the oldest epoch announced by any reader, or UINT64_MAX if all readers are quiescent
+	 */
+	uint64_t min_active() const;
+
+	/**
+	 * @return true if objects retired in epoch e can be freed
+	 */
+	bool safe_to_free(uint64_t e) const
+	{
+		return min_active() > e;
+	}
+
+private:
+	epoch_domain() : global_(1), head_(0)
+	{
+	}
+
+	epoch_domain(const epoch_domain&);
+	epoch_domain& operator=(const epoch_domain&);
+
+	epoch_record* acquire_record();
+	static void release_record(epoch_record* rec);
+
+	friend struct epoch_thread_slot;
+
+private:
+	std::atomic<uint64_t>		global_;
+	std::atomic<epoch_record*>	head_;
+};
+
+/**
+ * @brief RAII read-side critical section. May be nested.
+ */
+class epoch_guard {
+public:
+	epoch_guard() : rec_(epoch_domain::local_record())
+	{
+		epoch_domain::instance().enter(rec_);
+	}
+
+	~epoch_guard()
+	{
+		epoch_domain::instance().leave(rec_);
+	}
+
+private:
+	epoch_guard(const epoch_guard&);
+	epoch_guard& operator=(const epoch_guard&);
+
+private:
+	epoch_record*	rec_;
+};
+
+}
+
+#endif // LIBANT_CONTAINER_INTERNAL_EPOCH_H_
@@ -59,12 +59,21 @@
 #define LIBANT_CONTAINER_INTERNAL_STL_TREE_H_
 
 #include <cstddef>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #if __cplusplus >= 201103L
 
+#include <type_traits>
+
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
+
 #define _LIBANT_FORWARD(_Tp, __val) std::forward<_Tp>(__val)
 #define _LIBANT_NOEXCEPT noexcept
 
@@ -75,6 +84,12 @@
 
 #endif
 
+#if defined(__GNUC__)
+#define _LIBANT_PREFETCH(__addr) __builtin_prefetch(__addr)
+#else
+#define _LIBANT_PREFETCH(__addr) ((void)0)
+#endif
+
 namespace ant {
 
 // Red-black tree class, designed for use in implementing STL
@@ -97,6 +112,12 @@ enum _Rb_tree_color {
 	_S_red = false, _S_black = true
 };
 
+/// Memory layout requested from compact().
+enum compact_order {
+	link_order,	///< Nodes are laid out in insertion order.
+	key_order	///< Nodes are laid out in ascending key order.
+};
+
 struct _Rb_tree_node_base {
 	typedef _Rb_tree_node_base* _Base_ptr;
 	typedef const _Rb_tree_node_base* _Const_Base_ptr;
@@ -493,16 +514,270 @@ inline bool operator!=(const _Rb_tree_iterator<_Val>& __x,
 	return __x._M_node != __y._M_node;
 }
 
+class small_string;
+
+/**
+ *  @brief  Marks key types whose @c int @c compare(const _Key&) member
+ *          orders keys exactly like operator<.
+ *
+ *  %linked_map and %linked_set with the default std::less<_Key> call that
+ *  compare() once per tree level instead of operator< up to twice.  Only
+ *  key types marked here are picked up, since nothing else guarantees that
+ *  a compare() member agrees with operator<.  std::basic_string and
+ *  small_string are marked; specialize it with a true @c value for others.
+ */
+template<typename _Key>
+struct has_three_way_compare {
+	static const bool value = false;
+};
+
+template<typename _CharT, typename _Traits, typename _Alloc>
+struct has_three_way_compare<std::basic_string<_CharT, _Traits, _Alloc> > {
+	static const bool value = true;
+};
+
+template<>
+struct has_three_way_compare<small_string> {
+	static const bool value = true;
+};
+
+template<bool _Cond>
+struct _Rb_tree_enable_if {
+};
+
+template<>
+struct _Rb_tree_enable_if<true> {
+	typedef void type;
+};
+
+// Three-way comparison support.  When the key comparison object can tell
+// less, equal and greater apart in one call, lookups and unique insertions
+// descend the tree with a single comparison per level and stop as soon as
+// they meet an equal key.  A comparison object opts in by providing
+//
+//     int compare(const _Key& __x, const _Key& __y) const;
+//
+// returning a negative value, zero or a positive value.  std::less<_Key> is
+// picked up for the key types marked by has_three_way_compare.
+template<typename _Compare, typename _Key, typename = void>
+struct _Rb_tree_three_way {
+	static const bool value = false;
+
+	static int _S_compare(const _Compare& __c, const _Key& __x, const _Key& __y)
+	{
+		return __c(__x, __y) ? -1 : (__c(__y, __x) ? 1 : 0);
+	}
+};
+
+template<typename _Key>
+struct _Rb_tree_three_way<std::less<_Key>, _Key, typename _Rb_tree_enable_if<has_three_way_compare<_Key>::value>::type> {
+	static const bool value = true;
+
+	static int _S_compare(const std::less<_Key>&, const _Key& __x, const _Key& __y)
+	{
+		return __x.compare(__y);
+	}
+};
+
+// Three-way comparison of two keys by their own compare() member if they
+// have one, by operator< otherwise.
+template<typename _Tp, typename = void>
+struct _Rb_tree_key_compare {
+	static int _S_compare(const _Tp& __x, const _Tp& __y)
+	{
+		std::less<_Tp> __less;
+		return __less(__x, __y) ? -1 : (__less(__y, __x) ? 1 : 0);
+	}
+};
+
+#if __cplusplus >= 201103L
+template<typename _Tp>
+struct _Rb_tree_void {
+	typedef void type;
+};
+
+template<typename _Compare, typename _Key>
+struct _Rb_tree_three_way<_Compare, _Key, typename _Rb_tree_void<decltype(int(std::declval<const _Compare&>().compare(
+        std::declval<const _Key&>(), std::declval<const _Key&>())))>::type> {
+	static const bool value = true;
+
+	static int _S_compare(const _Compare& __c, const _Key& __x, const _Key& __y)
+	{
+		return __c.compare(__x, __y);
+	}
+};
+
+template<typename _Tp>
+struct _Rb_tree_key_compare<_Tp, typename _Rb_tree_void<decltype(int(std::declval<const _Tp&>().compare(
+        std::declval<const _Tp&>())))>::type> {
+	static int _S_compare(const _Tp& __x, const _Tp& __y)
+	{
+		return __x.compare(__y);
+	}
+};
+#endif
+
+/**
+ *  @brief  Comparison object for %linked_map and %linked_set that also
+ *          provides a three-way compare().
+ *
+ *  compare() uses @c __x.compare(__y) when @a _Tp has it and falls back to
+ *  two calls of operator< otherwise.  Choosing it asserts that such a
+ *  compare() orders like operator<; use it, or any comparison object of
+ *  your own with a compare() member, to let the tree stop at equal keys.
+ */
+template<typename _Tp>
+struct three_way_less : public std::less<_Tp> {
+	int compare(const _Tp& __x, const _Tp& __y) const
+	{
+		return _Rb_tree_key_compare<_Tp>::_S_compare(__x, __y);
+	}
+};
+
+#if __cplusplus >= 201103L
+// Heterogeneous lookup.  The _M_*_tr members of _Rb_tree take a key of any
+// type _Kt the comparison object can compare with _Key, and exist only when
+// the comparison object declares an is_transparent member type.
+template<typename _Compare, typename _Kt, typename = void>
+struct _Rb_tree_transparent {
+};
+
+template<typename _Compare, typename _Kt>
+struct _Rb_tree_transparent<_Compare, _Kt, typename _Rb_tree_void<typename _Compare::is_transparent>::type> {
+	typedef void type;
+};
+#endif
+
 void _Rb_tree_insert_and_rebalance(const bool __insert_left, _Rb_tree_node_base* __x,
 									_Rb_tree_node_base* __p, _Rb_tree_node_base& __header) throw ();
 
 _Rb_tree_node_base* _Rb_tree_rebalance_for_erase(_Rb_tree_node_base* const __z,
 													_Rb_tree_node_base& __header) throw ();
 
+/**
+ *  @brief  Marks allocators whose memory is released all at once, such as
+ *          arenas.
+ *
+ *  Specialize it with a true @c value for such an allocator.  %linked_map
+ *  and %linked_set using it skip the per-node walk on destruction and in
+ *  clear() when their values are trivially destructible; the nodes are
+ *  never handed back to deallocate().
+ *
+ *  A std::pmr::polymorphic_allocator counts as an arena while its memory
+ *  resource is a std::pmr::monotonic_buffer_resource.
+ */
+template<typename _Alloc>
+struct is_arena_allocator {
+	static const bool value = false;
+};
+
+template<typename _Alloc>
+inline bool _Rb_tree_alloc_is_arena(const _Alloc&)
+{
+	return is_arena_allocator<_Alloc>::value;
+}
+
+#if __cplusplus >= 201703L
+template<typename _Tp>
+inline bool _Rb_tree_alloc_is_arena(const std::pmr::polymorphic_allocator<_Tp>& __a)
+{
+	return dynamic_cast<std::pmr::monotonic_buffer_resource*>(__a.resource()) != 0;
+}
+#endif
+
+/**
+ *  @brief  Memory footprint of a %linked_map or %linked_set, as reported by
+ *          memory_usage().  All sizes are in bytes.
+ */
+struct container_memory_usage {
+	std::size_t node_count;
+	/// Color, parent, left and right links of every node and the header.
+	std::size_t tree_link_bytes;
+	/// Insertion-order prev and next links of every node and the header.
+	std::size_t chain_link_bytes;
+	/// sizeof(value_type) for every element.
+	std::size_t payload_bytes;
+	/// Memory owned by the elements themselves, see heap_bytes().
+	std::size_t heap_payload_bytes;
+	/// Padding inside the nodes, estimated allocator overhead and unused
+	/// slots of a compact() block.
+	std::size_t slack_bytes;
+
+	std::size_t total_bytes() const
+	{
+		return tree_link_bytes + chain_link_bytes + payload_bytes + heap_payload_bytes + slack_bytes;
+	}
+};
+
+/**
+ *  @brief  Estimated bookkeeping overhead of an allocator per block.
+ *
+ *  The default assumes an allocator without per-block overhead.  The
+ *  std::allocator specialization models a malloc that prefixes every block
+ *  with one word and rounds it up to 16 bytes, with a four-word minimum.
+ *  Specialize it for allocators whose overhead should show up in
+ *  memory_usage().
+ */
+template<typename _Alloc>
+struct allocator_overhead {
+	static std::size_t block(std::size_t)
+	{
+		return 0;
+	}
+};
+
+template<typename _Tp>
+struct allocator_overhead<std::allocator<_Tp> > {
+	static std::size_t block(std::size_t __bytes)
+	{
+		std::size_t __chunk = (__bytes + sizeof(std::size_t) + 15) & ~std::size_t(15);
+		if (__chunk < 4 * sizeof(std::size_t))
+			__chunk = 4 * sizeof(std::size_t);
+		return __chunk - __bytes;
+	}
+};
+
+/**
+ *  @brief  Returns the heap memory owned by @a __v, excluding sizeof(__v).
+ *
+ *  memory_usage() calls heap_bytes() unqualified on every element, so a
+ *  type that owns memory outside of itself can report it by providing an
+ *  overload in its own namespace.  Types without an overload own nothing.
+ */
+template<typename _Tp>
+inline std::size_t heap_bytes(const _Tp&)
+{
+	return 0;
+}
+
+template<typename _CharT, typename _Traits, typename _StrAlloc>
+inline std::size_t heap_bytes(const std::basic_string<_CharT, _Traits, _StrAlloc>& __s)
+{
+	// Short strings are kept inside the object.
+	std::less<const char*> __lt;
+	const char* __p = reinterpret_cast<const char*>(__s.data());
+	const char* __self = reinterpret_cast<const char*>(&__s);
+	if (!__lt(__p, __self) && __lt(__p, __self + sizeof(__s)))
+		return 0;
+	return (__s.capacity() + 1) * sizeof(_CharT);
+}
+
+template<typename _T1, typename _T2>
+inline std::size_t heap_bytes(const std::pair<_T1, _T2>& __p)
+{
+	return heap_bytes(__p.first) + heap_bytes(__p.second);
+}
+
 template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare,
 			typename _Alloc = std::allocator<_Val> >
 class _Rb_tree {
+#if __cplusplus >= 201103L
+	typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<_Rb_tree_node<_Val> > _Node_allocator;
+	typedef std::allocator_traits<_Node_allocator> _Node_alloc_traits;
+#else
 	typedef typename _Alloc::template rebind<_Rb_tree_node<_Val> >::other _Node_allocator;
+#endif
+	typedef _Rb_tree_three_way<_Compare, _Key> _Three_way;
 
 protected:
 	typedef _Rb_tree_node_base* _Base_ptr;
@@ -537,14 +812,75 @@ public:
 	}
 
 protected:
+	// Header of the block of nodes allocated by compact().
+	struct _Arena {
+		size_type _M_size; // Nodes in the block.
+		size_type _M_live; // Nodes not erased yet.
+	};
+
+	_Link_type _M_allocate_nodes(size_type __n)
+	{
+#if __cplusplus >= 201103L
+		return _Node_alloc_traits::allocate(_M_get_Node_allocator(), __n);
+#else
+		return _M_impl._Node_allocator::allocate(__n);
+#endif
+	}
+
+	void _M_deallocate_nodes(_Link_type __p, size_type __n)
+	{
+#if __cplusplus >= 201103L
+		_Node_alloc_traits::deallocate(_M_get_Node_allocator(), __p, __n);
+#else
+		_M_impl._Node_allocator::deallocate(__p, __n);
+#endif
+	}
+
 	_Link_type _M_get_node()
 	{
-		return _M_impl._Node_allocator::allocate(1);
+		return _M_allocate_nodes(1);
 	}
 
 	void _M_put_node(_Link_type __p)
 	{
-		_M_impl._Node_allocator::deallocate(__p, 1);
+		if (_M_in_arena(__p)) {
+			if (--_M_impl._M_arena->_M_live == 0) {
+				_M_deallocate_nodes(_S_arena_block(_M_impl._M_arena), _M_impl._M_arena->_M_size + 1);
+				_M_impl._M_arena = 0;
+			}
+		} else
+			_M_deallocate_nodes(__p, 1);
+	}
+
+	/**
+	 *  Returns true if the nodes may be dropped without visiting them: the
+	 *  values need no destructor and the allocator releases its memory in
+	 *  bulk.
+	 */
+	bool _M_can_abandon_nodes() const
+	{
+#if __cplusplus >= 201103L
+		return std::is_trivially_destructible<_Val>::value
+		        && _Rb_tree_alloc_is_arena(_M_get_Node_allocator());
+#else
+		return false;
+#endif
+	}
+
+	bool _M_in_arena(_Const_Link_type __p) const
+	{
+		std::less<_Const_Link_type> __lt;
+		if (_M_impl._M_arena == 0)
+			return false;
+		_Const_Link_type const __first = _S_arena_block(_M_impl._M_arena) + 1;
+		return !__lt(__p, __first) && __lt(__p, __first + _M_impl._M_arena->_M_size);
+	}
+
+	// The compact() block starts with its header, in a slot of its own;
+	// the nodes follow it.
+	static _Link_type _S_arena_block(_Arena* __a)
+	{
+		return reinterpret_cast<_Link_type>(__a);
 	}
 
 #if __cplusplus < 201103L
@@ -588,7 +924,7 @@ protected:
 
 	void _M_destroy_node(_Link_type __p)
 	{
-		_M_get_Node_allocator().destroy(__p);
+		_Node_alloc_traits::destroy(_M_get_Node_allocator(), __p);
 		_M_put_node(__p);
 	}
 #endif
@@ -609,27 +945,38 @@ protected:
 		_Key_compare _M_key_compare;
 		_Rb_tree_node_base _M_header;
 		size_type _M_node_count; // Keeps track of size of tree.
+		// Block of nodes allocated by compact().  Its nodes are not
+		// deallocated one by one; the block goes with its last node.
+		_Arena* _M_arena;
 
 		_Rb_tree_impl() :
-			_Node_allocator(), _M_key_compare(), _M_header(), _M_node_count(0)
+			_Node_allocator(), _M_key_compare(), _M_header(), _M_node_count(0),
+			_M_arena(0)
 		{
 			_M_initialize();
 		}
 
 		_Rb_tree_impl(const _Key_compare& __comp, const _Node_allocator& __a) :
-				_Node_allocator(__a), _M_key_compare(__comp), _M_header(), _M_node_count(0)
+				_Node_allocator(__a), _M_key_compare(__comp), _M_header(), _M_node_count(0),
+				_M_arena(0)
 		{
 			_M_initialize();
 		}
 
 #if __cplusplus >= 201103L
 		_Rb_tree_impl(const _Key_compare& __comp, _Node_allocator&& __a) :
-				_Node_allocator(std::move(__a)), _M_key_compare(__comp), _M_header(), _M_node_count(0)
+				_Node_allocator(std::move(__a)), _M_key_compare(__comp), _M_header(), _M_node_count(0),
+				_M_arena(0)
 		{
 			_M_initialize();
 		}
 #endif
 
+		void _M_swap_arena(_Rb_tree_impl& __x)
+		{
+			std::swap(_M_arena, __x._M_arena);
+		}
+
 		void _M_init_list_head()
 		{
 			_M_header._M_prev = &_M_header;
@@ -754,6 +1101,11 @@ protected:
 		return _KeyOfValue()(_S_value(__x));
 	}
 
+	int _M_compare(const _Key& __x, const _Key& __y) const
+	{
+		return _Three_way::_S_compare(_M_impl._M_key_compare, __x, __y);
+	}
+
 	static _Base_ptr _S_minimum(_Base_ptr __x)
 	{
 		return _Rb_tree_node_base::_S_minimum(__x);
@@ -774,6 +1126,18 @@ protected:
 		return _Rb_tree_node_base::_S_maximum(__x);
 	}
 
+	template<typename _Iterator>
+	static void _S_split(_Const_Base_ptr __x, size_type __depth, _Const_Base_ptr __leftmost,
+						 std::vector<_Iterator>& __b)
+	{
+		if (__x == 0 || __depth == 0)
+			return;
+		_S_split(__x->_M_left, __depth - 1, __leftmost, __b);
+		if (__x != __leftmost)
+			__b.push_back(_Iterator(static_cast<_Link_type>(const_cast<_Base_ptr>(__x))));
+		_S_split(__x->_M_right, __depth - 1, __leftmost, __b);
+	}
+
 public:
 	typedef _Rb_tree_iterator<value_type> iterator;
 	typedef _Rb_tree_const_iterator<value_type> const_iterator;
@@ -833,6 +1197,131 @@ private:
 #endif
 
 	void _M_erase(_Link_type __x);
+
+	// Bulk traversal.  A second cursor runs _S_prefetch_distance nodes
+	// ahead of the visited one and prefetches each node it reaches, so the
+	// dependent loads of the chain overlap with the work done by __f.
+	enum { _S_prefetch_distance = 8, _S_batch_size = 16 };
+
+	struct _Link_step {
+		static _Base_ptr _S_next(_Base_ptr __x)
+		{
+			return __x->_M_next;
+		}
+	};
+
+	struct _Key_step {
+		static _Base_ptr _S_next(_Base_ptr __x)
+		{
+			return _Rb_tree_increment(__x);
+		}
+	};
+
+	template<typename _Ptr, typename _Function>
+	struct _Batch_visitor {
+		_Function& _M_f;
+		_Ptr _M_batch[_S_batch_size];
+		size_type _M_n;
+
+		explicit _Batch_visitor(_Function& __f) : _M_f(__f), _M_n(0)
+		{
+		}
+
+		void operator()(typename std::iterator_traits<_Ptr>::reference __v)
+		{
+			_M_batch[_M_n++] = std::__addressof(__v);
+			if (_M_n == _S_batch_size)
+				_M_flush();
+		}
+
+		void _M_flush()
+		{
+			if (_M_n != 0)
+				_M_f(static_cast<_Ptr const*>(_M_batch), _M_n);
+			_M_n = 0;
+		}
+	};
+
+	static void _S_prefetch_node(_Const_Base_ptr __x)
+	{
+		_LIBANT_PREFETCH(__x);
+		if (sizeof(_Rb_tree_node<_Val>) > 64)
+			_LIBANT_PREFETCH(reinterpret_cast<const char*>(__x) + 64);
+	}
+
+	template<typename _Step, typename _Ptr, typename _Function>
+	void _M_prefetch_walk(_Base_ptr __x, _Function& __f) const
+	{
+		_Const_Base_ptr const __end = &this->_M_impl._M_header;
+		_Base_ptr __ahead = __x;
+		for (int __i = 0; __i < _S_prefetch_distance && __ahead != __end; ++__i) {
+			__ahead = _Step::_S_next(__ahead);
+			_S_prefetch_node(__ahead);
+		}
+		while (__x != __end) {
+			if (__ahead != __end) {
+				__ahead = _Step::_S_next(__ahead);
+				_S_prefetch_node(__ahead);
+			}
+			_Base_ptr __next = _Step::_S_next(__x);
+			__f(*static_cast<_Ptr>(std::__addressof(static_cast<_Link_type>(__x)->_M_value_field)));
+			__x = __next;
+		}
+	}
+
+	template<typename _Step, typename _Ptr, typename _Function>
+	void _M_prefetch_walk_batch(_Base_ptr __x, _Function& __f) const
+	{
+		_Batch_visitor<_Ptr, _Function> __v(__f);
+		_M_prefetch_walk<_Step, _Ptr>(__x, __v);
+		__v._M_flush();
+	}
+
+	_Base_ptr _M_first_in_key_order() const
+	{
+		return const_cast<_Base_ptr>(this->_M_impl._M_header._M_left);
+	}
+
+	_Base_ptr _M_first_in_link_order() const
+	{
+		return this->_M_impl._M_header._M_next;
+	}
+
+#if __cplusplus >= 201103L
+	_Base_ptr _M_build_balanced(size_type __n, size_type __depth, size_type __red_depth,
+								_Base_ptr& __src, _Base_ptr __parent);
+
+	// Takes over the nodes of __x, whose allocator must compare equal to ours.
+	void _M_move_data(_Rb_tree& __x);
+
+	static void _S_alloc_on_copy(_Node_allocator& __a, const _Node_allocator& __b, std::true_type)
+	{
+		__a = __b;
+	}
+
+	static void _S_alloc_on_copy(_Node_allocator&, const _Node_allocator&, std::false_type)
+	{
+	}
+
+	static void _S_alloc_on_move(_Node_allocator& __a, _Node_allocator& __b, std::true_type)
+	{
+		__a = std::move(__b);
+	}
+
+	static void _S_alloc_on_move(_Node_allocator&, _Node_allocator&, std::false_type)
+	{
+	}
+
+	static void _S_alloc_on_swap(_Node_allocator& __a, _Node_allocator& __b, std::true_type)
+	{
+		using std::swap;
+		swap(__a, __b);
+	}
+
+	static void _S_alloc_on_swap(_Node_allocator&, _Node_allocator&, std::false_type)
+	{
+	}
+#endif
 	iterator _M_lower_bound(_Link_type __x, _Link_type __y, const _Key& __k);
 	const_iterator _M_lower_bound(_Const_Link_type __x, _Const_Link_type __y, const _Key& __k) const;
 	iterator _M_upper_bound(_Link_type __x, _Link_type __y, const _Key& __k);
@@ -850,7 +1339,12 @@ public:
 	}
 
 	_Rb_tree(const _Rb_tree& __x)
+#if __cplusplus >= 201103L
+		: _M_impl(__x._M_impl._M_key_compare,
+		          _Node_alloc_traits::select_on_container_copy_construction(__x._M_get_Node_allocator()))
+#else
 		: _M_impl(__x._M_impl._M_key_compare, __x._M_get_Node_allocator())
+#endif
 	{
 		if (__x._M_root() != 0) {
 			_M_insert_unique(__x.link_begin(), __x.link_end());
@@ -858,16 +1352,32 @@ public:
 	}
 
 #if __cplusplus >= 201103L
+	_Rb_tree(const _Rb_tree& __x, const allocator_type& __a)
+		: _M_impl(__x._M_impl._M_key_compare, _Node_allocator(__a))
+	{
+		if (__x._M_root() != 0) {
+			_M_insert_unique(__x.link_begin(), __x.link_end());
+		}
+	}
+
 	_Rb_tree(_Rb_tree&& __x);
+
+	_Rb_tree(_Rb_tree&& __x, const allocator_type& __a);
 #endif
 
 	~_Rb_tree() _LIBANT_NOEXCEPT
 	{
-		_M_erase(_M_begin());
+		if (!_M_can_abandon_nodes())
+			_M_erase(_M_begin());
 	}
 
 	_Rb_tree& operator=(const _Rb_tree& __x);
 
+#if __cplusplus >= 201103L
+	// Move assignment honouring propagate_on_container_move_assignment.
+	void _M_move_assign(_Rb_tree& __x);
+#endif
+
 	// Accessors.
 	_Compare key_comp() const
 	{
@@ -969,7 +1479,56 @@ public:
 
 	size_type max_size() const _LIBANT_NOEXCEPT
 	{
+#if __cplusplus >= 201103L
+		return _Node_alloc_traits::max_size(_M_get_Node_allocator());
+#else
 		return _M_get_Node_allocator().max_size();
+#endif
+	}
+
+	/**
+	 *  Returns key-order iterators cutting the tree into about @a __parts
+	 *  ranges of similar size: begin(), the nodes of the top levels of the
+	 *  tree in key order, end().  Red-black balance keeps subtrees of the
+	 *  same depth within a small factor of each other.  Takes O(__parts).
+	 */
+	template<typename _Iterator>
+	std::vector<_Iterator> _M_split(size_type __parts) const
+	{
+		size_type __depth = 0;
+		while ((size_type(1) << __depth) < __parts && __depth + 1 < sizeof(size_type) * 8)
+			++__depth;
+		std::vector<_Iterator> __b;
+		__b.reserve(size_type(1) << __depth);
+		__b.push_back(_Iterator(static_cast<_Link_type>(const_cast<_Base_ptr>(_M_leftmost()))));
+		_S_split(_M_root(), __depth, _M_leftmost(), __b);
+		__b.push_back(_Iterator(const_cast<_Link_type>(_M_end())));
+		return __b;
+	}
+
+	/**
+	 *  Reports the memory used by the tree.  Takes linear time, as
+	 *  heap_bytes() is summed over all elements.
+	 */
+	container_memory_usage memory_usage() const;
+
+	/**
+	 *  Returns the bytes each element costs beyond sizeof(value_type):
+	 *  links, padding and estimated allocator overhead.
+	 */
+	static size_type node_overhead()
+	{
+		return sizeof(_Rb_tree_node<_Val>) - sizeof(_Val)
+				+ allocator_overhead<_Node_allocator>::block(sizeof(_Rb_tree_node<_Val>));
+	}
+
+	/**
+	 *  Returns true if @a __k orders after every key in the tree, so that it
+	 *  would be inserted right after _M_rightmost().
+	 */
+	bool _M_past_rightmost(const key_type& __k) const
+	{
+		return _M_impl._M_node_count != 0 && _M_impl._M_key_compare(_S_key(_M_rightmost()), __k);
 	}
 
 	void swap(_Rb_tree& __t);
@@ -1035,6 +1594,14 @@ private:
 	void _M_erase_aux(const_insert_order_iterator __position);
 	void _M_erase_aux(const_insert_order_iterator __first, const_insert_order_iterator __last);
 
+	void _M_move_to_last(_Base_ptr __x) _LIBANT_NOEXCEPT
+	{
+		if (__x->_M_next != &_M_impl._M_header) {
+			__x->_M_unhook();
+			__x->_M_hook(&_M_impl._M_header);
+		}
+	}
+
 public:
 #if __cplusplus >= 201103L
 	// DR 130. Associative erase should return an iterator.
@@ -1095,6 +1662,16 @@ public:
 #endif
 	size_type erase(const key_type& __x);
 
+	void move_to_last(const_iterator __position) _LIBANT_NOEXCEPT
+	{
+		_M_move_to_last(const_cast<_Base_ptr>(__position._M_node));
+	}
+
+	void move_to_last(const_insert_order_iterator __position) _LIBANT_NOEXCEPT
+	{
+		_M_move_to_last(const_cast<_Base_ptr>(__position._M_node));
+	}
+
 #if __cplusplus >= 201103L
 	// DR 130. Associative erase should return an iterator.
 	iterator erase(const_iterator __first, const_iterator __last)
@@ -1133,7 +1710,11 @@ public:
 
 	void clear() _LIBANT_NOEXCEPT
 	{
-		_M_erase(_M_begin());
+		if (_M_can_abandon_nodes()) {
+			// Nodes of the compact() block go with the arena as well.
+			_M_impl._M_arena = 0;
+		} else
+			_M_erase(_M_begin());
 		_M_leftmost() = _M_end();
 		_M_root() = 0;
 		_M_rightmost() = _M_end();
@@ -1177,6 +1758,122 @@ public:
 	std::pair<const_iterator, const_iterator>
 	equal_range(const key_type& __k) const;
 
+#if __cplusplus >= 201103L
+	template<typename _Kt, typename _Req = typename _Rb_tree_transparent<_Compare, _Kt>::type>
+	iterator _M_find_tr(const _Kt& __k)
+	{
+		const _Rb_tree* __const_this = this;
+		return __const_this->_M_find_tr(__k)._M_const_cast();
+	}
+
+	template<typename _Kt, typename _Req = typename _Rb_tree_transparent<_Compare, _Kt>::type>
+	const_iterator _M_find_tr(const _Kt& __k) const
+	{
+		const_iterator __j = _M_lower_bound_tr(__k);
+		return (__j == end() || _M_impl._M_key_compare(__k, _S_key(__j._M_node))) ? end() : __j;
+	}
+
+	template<typename _Kt, typename _Req = typename _Rb_tree_transparent<_Compare, _Kt>::type>
+	size_type _M_count_tr(const _Kt& __k) const
+	{
+		return std::distance(_M_lower_bound_tr(__k), _M_upper_bound_tr(__k));
+	}
+
+	template<typename _Kt, typename _Req = typename _Rb_tree_transparent<_Compare, _Kt>::type>
+	iterator _M_lower_bound_tr(const _Kt& __k)
+	{
+		const _Rb_tree* __const_this = this;
+		return __const_this->_M_lower_bound_tr(__k)._M_const_cast();
+	}
+
+	template<typename _Kt, typename _Req = typename _Rb_tree_transparent<_Compare, _Kt>::type>
+	const_iterator _M_lower_bound_tr(const _Kt& __k) const
+	{
+		_Const_Link_type __x = _M_begin();
+		_Const_Link_type __y = _M_end();
+		while (__x != 0)
+			if (!_M_impl._M_key_compare(_S_key(__x), __k))
+				__y = __x, __x = _S_left(__x);
+			else
+				__x = _S_right(__x);
+		return const_iterator(__y);
+	}
+
+	template<typename _Kt, typename _Req = typename _Rb_tree_transparent<_Compare, _Kt>::type>
+	iterator _M_upper_bound_tr(const _Kt& __k)
+	{
+		const _Rb_tree* __const_this = this;
+		return __const_this->_M_upper_bound_tr(__k)._M_const_cast();
+	}
+
+	template<typename _Kt, typename _Req = typename _Rb_tree_transparent<_Compare, _Kt>::type>
+	const_iterator _M_upper_bound_tr(const _Kt& __k) const
+	{
+		_Const_Link_type __x = _M_begin();
+		_Const_Link_type __y = _M_end();
+		while (__x != 0)
+			if (_M_impl._M_key_compare(__k, _S_key(__x)))
+				__y = __x, __x = _S_left(__x);
+			else
+				__x = _S_right(__x);
+		return const_iterator(__y);
+	}
+#endif
+
+#if __cplusplus >= 201103L
+	void compact(compact_order __order);
+#endif
+
+	// Bulk traversal.  __f receives a reference to each element; the batch
+	// variants pass arrays of up to _S_batch_size element pointers instead.
+	template<typename _Function>
+	void for_each(_Function& __f)
+	{
+		_M_prefetch_walk<_Key_step, pointer>(_M_first_in_key_order(), __f);
+	}
+
+	template<typename _Function>
+	void for_each(_Function& __f) const
+	{
+		_M_prefetch_walk<_Key_step, const_pointer>(_M_first_in_key_order(), __f);
+	}
+
+	template<typename _Function>
+	void for_each_link(_Function& __f)
+	{
+		_M_prefetch_walk<_Link_step, pointer>(_M_first_in_link_order(), __f);
+	}
+
+	template<typename _Function>
+	void for_each_link(_Function& __f) const
+	{
+		_M_prefetch_walk<_Link_step, const_pointer>(_M_first_in_link_order(), __f);
+	}
+
+	template<typename _Function>
+	void for_each_batch(_Function& __f)
+	{
+		_M_prefetch_walk_batch<_Key_step, pointer>(_M_first_in_key_order(), __f);
+	}
+
+	template<typename _Function>
+	void for_each_batch(_Function& __f) const
+	{
+		_M_prefetch_walk_batch<_Key_step, const_pointer>(_M_first_in_key_order(), __f);
+	}
+
+	template<typename _Function>
+	void for_each_link_batch(_Function& __f)
+	{
+		_M_prefetch_walk_batch<_Link_step, pointer>(_M_first_in_link_order(), __f);
+	}
+
+	template<typename _Function>
+	void for_each_link_batch(_Function& __f) const
+	{
+		_M_prefetch_walk_batch<_Link_step, const_pointer>(_M_first_in_link_order(), __f);
+	}
+
 	// Debugging.
 	bool
 	__rb_verify() const;
@@ -1250,6 +1947,43 @@ inline void swap(_Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>& __x,
 template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare, typename _Alloc>
 _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::_Rb_tree(_Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc> && __x)
 	: _M_impl(__x._M_impl._M_key_compare, std::move(__x._M_get_Node_allocator()))
+{
+	_M_move_data(__x);
+}
+
+template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare, typename _Alloc>
+_Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::_Rb_tree(_Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc> && __x,
+                                                             const allocator_type& __a)
+	: _M_impl(__x._M_impl._M_key_compare, _Node_allocator(__a))
+{
+	if (_M_get_Node_allocator() == __x._M_get_Node_allocator())
+		_M_move_data(__x);
+	else if (__x._M_root() != 0)
+		// Memory of __x cannot be taken over: move the elements one by one.
+		_M_insert_unique(std::make_move_iterator(__x.link_begin()),
+		                 std::make_move_iterator(__x.link_end()));
+}
+
+template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare, typename _Alloc>
+void _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::_M_move_assign(_Rb_tree& __x)
+{
+	clear();
+	_M_impl._M_key_compare = __x._M_impl._M_key_compare;
+	if (_Node_alloc_traits::propagate_on_container_move_assignment::value
+	        || _M_get_Node_allocator() == __x._M_get_Node_allocator()) {
+		_S_alloc_on_move(_M_get_Node_allocator(), __x._M_get_Node_allocator(),
+		                 typename _Node_alloc_traits::propagate_on_container_move_assignment());
+		_M_move_data(__x);
+	} else if (__x._M_root() != 0) {
+		// Memory of __x cannot be taken over: move the elements one by one.
+		_M_insert_unique(std::make_move_iterator(__x.link_begin()),
+		                 std::make_move_iterator(__x.link_end()));
+		__x.clear();
+	}
+}
+
+template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare, typename _Alloc>
+void _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::_M_move_data(_Rb_tree& __x)
 {
 	if (__x._M_root() != 0) {
 		_M_root() = __x._M_root();
@@ -1261,6 +1995,7 @@ _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::_Rb_tree(_Rb_tree<_Key, _Va
 		_M_impl._M_header._M_prev = __x._M_impl._M_header._M_prev;
 		_M_impl._M_header._M_next = __x._M_impl._M_header._M_next;
 		_M_impl._M_node_count = __x._M_impl._M_node_count;
+		_M_impl._M_swap_arena(__x._M_impl);
 
 		__x._M_root() = 0;
 		__x._M_leftmost() = __x._M_end();
@@ -1277,7 +2012,12 @@ _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::operator=(const _Rb_tree<_K
 {
 	if (this != &__x) {
 		// Note that _Key may be a constant type.
+		// The nodes go back to the old allocator before it is replaced.
 		clear();
+#if __cplusplus >= 201103L
+		_S_alloc_on_copy(_M_get_Node_allocator(), __x._M_get_Node_allocator(),
+		                 typename _Node_alloc_traits::propagate_on_container_copy_assignment());
+#endif
 		_M_impl._M_key_compare = __x._M_impl._M_key_compare;
 		if (__x._M_root() != 0) {
 			_M_insert_unique(__x.link_begin(), __x.link_end());
@@ -1433,9 +2173,10 @@ std::pair<
 	_Link_type __x = _M_begin();
 	_Link_type __y = _M_end();
 	while (__x != 0) {
-		if (_M_impl._M_key_compare(_S_key(__x), __k))
+		int __c = _Three_way::value ? _M_compare(__k, _S_key(__x)) : 0;
+		if (_Three_way::value ? __c > 0 : _M_impl._M_key_compare(_S_key(__x), __k))
 			__x = _S_right(__x);
-		else if (_M_impl._M_key_compare(__k, _S_key(__x)))
+		else if (_Three_way::value ? __c < 0 : _M_impl._M_key_compare(__k, _S_key(__x)))
 			__y = __x, __x = _S_left(__x);
 		else {
 			_Link_type __xu(__x), __yu(__y);
@@ -1459,9 +2200,10 @@ std::pair<
 	_Const_Link_type __x = _M_begin();
 	_Const_Link_type __y = _M_end();
 	while (__x != 0) {
-		if (_M_impl._M_key_compare(_S_key(__x), __k))
+		int __c = _Three_way::value ? _M_compare(__k, _S_key(__x)) : 0;
+		if (_Three_way::value ? __c > 0 : _M_impl._M_key_compare(_S_key(__x), __k))
 			__x = _S_right(__x);
-		else if (_M_impl._M_key_compare(__k, _S_key(__x)))
+		else if (_Three_way::value ? __c < 0 : _M_impl._M_key_compare(__k, _S_key(__x)))
 			__y = __x, __x = _S_left(__x);
 		else {
 			_Const_Link_type __xu(__x), __yu(__y);
@@ -1523,11 +2265,17 @@ void _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::swap(_Rb_tree<_Key, _V
 	}
 	// No need to swap header's color as it does not change.
 	std::swap(_M_impl._M_node_count, __t._M_impl._M_node_count);
+	_M_impl._M_swap_arena(__t._M_impl);
 	std::swap(_M_impl._M_key_compare, __t._M_impl._M_key_compare);
 
 	// 431. Swapping containers with unequal allocators.
+#if __cplusplus >= 201103L
+	_S_alloc_on_swap(_M_get_Node_allocator(), __t._M_get_Node_allocator(),
+	                 typename _Node_alloc_traits::propagate_on_container_swap());
+#else
 	std::__alloc_swap<_Node_allocator>::_S_do_it(_M_get_Node_allocator(),
 													__t._M_get_Node_allocator());
+#endif
 }
 
 template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare,
@@ -1539,8 +2287,30 @@ std::pair<
         const key_type& __k)
 {
 	typedef std::pair<_Base_ptr, _Base_ptr> _Res;
+	// Keys arriving in increasing order, such as sequence numbers or
+	// timestamps, go straight after the rightmost node.
+	if (_M_past_rightmost(__k))
+		return _Res(0, _M_rightmost());
+
 	_Link_type __x = _M_begin();
 	_Link_type __y = _M_end();
+	if (_Three_way::value) {
+		// Keys are unique, so an equal key lies on the search path.
+		while (__x != 0) {
+			const int __c = _M_compare(__k, _S_key(__x));
+			if (__c == 0)
+				return _Res(__x, 0);
+			__y = __x;
+			if (__c < 0) {
+				__x = _S_left(__x);
+				if (__x == 0)
+					return _Res(__y, __y); // a non-null first member means insert left
+			} else
+				__x = _S_right(__x);
+		}
+		return _Res(0, __y);
+	}
+
 	bool __comp = true;
 	while (__x != 0) {
 		__y = __x;
@@ -1635,10 +2405,8 @@ std::pair<
 
 	// end()
 	if (__pos._M_node == _M_end()) {
-		if (size() > 0 && _M_impl._M_key_compare(_S_key(_M_rightmost()), __k))
-			return _Res(0, _M_rightmost());
-		else
-			return _M_get_insert_unique_pos(__k);
+		// _M_get_insert_unique_pos() checks _M_rightmost() first.
+		return _M_get_insert_unique_pos(__k);
 	} else if (_M_impl._M_key_compare(__k, _S_key(__pos._M_node))) {
 		// First, try before...
 		iterator __before = __pos;
@@ -1985,6 +2753,20 @@ template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare,
 typename _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::iterator _Rb_tree<
         _Key, _Val, _KeyOfValue, _Compare, _Alloc>::find(const _Key& __k)
 {
+	if (_Three_way::value) {
+		_Link_type __x = _M_begin();
+		while (__x != 0) {
+			const int __c = _M_compare(__k, _S_key(__x));
+			if (__c < 0)
+				__x = _S_left(__x);
+			else if (__c > 0)
+				__x = _S_right(__x);
+			else
+				return iterator(__x);
+		}
+		return end();
+	}
+
 	iterator __j = _M_lower_bound(_M_begin(), _M_end(), __k);
 	return (__j == end() || _M_impl._M_key_compare(__k, _S_key(__j._M_node))) ?
 	        end() : __j;
@@ -1995,6 +2777,20 @@ template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare,
 typename _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::const_iterator _Rb_tree<
         _Key, _Val, _KeyOfValue, _Compare, _Alloc>::find(const _Key& __k) const
 {
+	if (_Three_way::value) {
+		_Const_Link_type __x = _M_begin();
+		while (__x != 0) {
+			const int __c = _M_compare(__k, _S_key(__x));
+			if (__c < 0)
+				__x = _S_left(__x);
+			else if (__c > 0)
+				__x = _S_right(__x);
+			else
+				return const_iterator(__x);
+		}
+		return end();
+	}
+
 	const_iterator __j = _M_lower_bound(_M_begin(), _M_end(), __k);
 	return (__j == end() || _M_impl._M_key_compare(__k, _S_key(__j._M_node))) ?
 	        end() : __j;
@@ -2010,6 +2806,130 @@ typename _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::size_type _Rb_tree
 	return __n;
 }
 
+template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare, typename _Alloc>
+container_memory_usage _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::memory_usage() const
+{
+	typedef _Rb_tree_node<_Val> _Node;
+	typedef allocator_overhead<_Node_allocator> _Overhead;
+
+	const std::size_t __tree_links = offsetof(_Rb_tree_node_base, _M_prev);
+	const std::size_t __chain_links = sizeof(_Rb_tree_node_base) - __tree_links;
+	const size_type __n = size();
+	// Nodes in the compact() block share a single allocation.
+	const size_type __pooled = _M_impl._M_arena != 0 ? _M_impl._M_arena->_M_live : 0;
+
+	container_memory_usage __u;
+	__u.node_count = __n;
+	__u.tree_link_bytes = (__n + 1) * __tree_links;
+	__u.chain_link_bytes = (__n + 1) * __chain_links;
+	__u.payload_bytes = __n * sizeof(_Val);
+	__u.heap_payload_bytes = 0;
+	for (_Const_Base_ptr __x = _M_impl._M_header._M_next; __x != &_M_impl._M_header; __x = __x->_M_next)
+		__u.heap_payload_bytes += heap_bytes(static_cast<_Const_Link_type>(__x)->_M_value_field);
+	__u.slack_bytes = __n * (sizeof(_Node) - sizeof(_Rb_tree_node_base) - sizeof(_Val))
+			+ (__n - __pooled) * _Overhead::block(sizeof(_Node));
+	if (_M_impl._M_arena != 0)
+		__u.slack_bytes += (_M_impl._M_arena->_M_size + 1 - __pooled) * sizeof(_Node)
+				+ _Overhead::block((_M_impl._M_arena->_M_size + 1) * sizeof(_Node));
+	return __u;
+}
+
+#if __cplusplus >= 201103L
+// Builds a perfectly balanced tree of __n nodes.  The nodes are taken in key
+// order from the old tree starting at __src, each old node's _M_prev naming
+// its relocated copy.  Every level but the deepest is full; the deepest one
+// (__red_depth) is colored red unless it holds the root, which keeps black
+// heights equal.
+template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare, typename _Alloc>
+typename _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::_Base_ptr
+_Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::_M_build_balanced(size_type __n, size_type __depth,
+																		size_type __red_depth, _Base_ptr& __src,
+																		_Base_ptr __parent)
+{
+	if (__n == 0)
+		return 0;
+
+	const size_type __nleft = (__n - 1) / 2;
+	_Base_ptr __left = _M_build_balanced(__nleft, __depth + 1, __red_depth, __src, 0);
+	_Base_ptr __z = __src->_M_prev;
+	__src = _Rb_tree_increment(__src);
+
+	__z->_M_parent = __parent;
+	__z->_M_left = __left;
+	if (__left)
+		__left->_M_parent = __z;
+	__z->_M_right = _M_build_balanced(__n - 1 - __nleft, __depth + 1, __red_depth, __src, __z);
+	__z->_M_color = (__depth == __red_depth && __depth != 0) ? _S_red : _S_black;
+	return __z;
+}
+
+template<typename _Key, typename _Val, typename _KeyOfValue, typename _Compare, typename _Alloc>
+void _Rb_tree<_Key, _Val, _KeyOfValue, _Compare, _Alloc>::compact(compact_order __order)
+{
+	const size_type __n = size();
+	if (__n == 0)
+		return;
+
+	_Base_ptr const __header = &this->_M_impl._M_header;
+	_Link_type const __block = _M_allocate_nodes(__n + 1);
+	_Link_type const __arena = __block + 1;
+	size_type __i = 0;
+
+	// Relocate the values.  Each old node remembers its copy in _M_prev,
+	// which neither traversal below reads.
+	__try
+	{
+		_Base_ptr __x = (__order == key_order) ? _M_leftmost() : __header->_M_next;
+		for (; __x != __header; ++__i) {
+			_Link_type __z = __arena + __i;
+			std::allocator_traits<_Node_allocator>::construct(_M_get_Node_allocator(), __z,
+					std::move_if_noexcept(static_cast<_Link_type>(__x)->_M_value_field));
+			__x->_M_prev = __z;
+			__x = (__order == key_order) ? _Rb_tree_increment(__x) : __x->_M_next;
+		}
+	}
+	__catch(...)
+	{
+		while (__i != 0)
+			std::allocator_traits<_Node_allocator>::destroy(_M_get_Node_allocator(), __arena + --__i);
+		_M_deallocate_nodes(__block, __n + 1);
+		for (_Base_ptr __x = __header; __x->_M_next != __header; __x = __x->_M_next)
+			__x->_M_next->_M_prev = __x;
+		__header->_M_prev->_M_next = __header;
+		__throw_exception_again;
+	}
+
+	// Chain the copies in the old insertion order.
+	_Base_ptr __prev = __header;
+	for (_Base_ptr __x = __header->_M_next; __x != __header; __x = __x->_M_next) {
+		__prev->_M_next = __x->_M_prev;
+		__x->_M_prev->_M_prev = __prev;
+		__prev = __x->_M_prev;
+	}
+	__prev->_M_next = __header;
+	_Base_ptr const __first = __header->_M_next;
+
+	size_type __height = 0;
+	while ((size_type(1) << __height) <= __n)
+		++__height;
+	_Base_ptr __src = _M_leftmost();
+	_Base_ptr __root = _M_build_balanced(__n, 0, __height - 1, __src, __header);
+
+	// Destroy the old nodes.  Their tree links are still intact.
+	_M_erase(_M_begin());
+
+	_M_root() = __root;
+	_M_leftmost() = _S_minimum(__root);
+	_M_rightmost() = _S_maximum(__root);
+	__header->_M_next = __first;
+	__header->_M_prev = __prev;
+	_Arena* const __a = ::new (static_cast<void*>(__block)) _Arena;
+	__a->_M_size = __n;
+	__a->_M_live = __n;
+	_M_impl._M_arena = __a;
+}
+#endif
+
 unsigned int _Rb_tree_black_count(const _Rb_tree_node_base* __node,
 									const _Rb_tree_node_base* __root) throw ();
 
@@ -0,0 +1,138 @@
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "interned_string.h"
+
+namespace ant {
+
+namespace {
+
+template<typename _Rep>
+struct intern_shard {
+	intern_shard() : buckets(16), count(0), bytes(0)
+	{
+	}
+
+	std::mutex			mtx;
+	std::vector<_Rep*>	buckets;	// chained through next_, size a power of 2
+	size_t				count;
+	size_t				bytes;
+};
+
+}
+
+// The shard is picked with the top bits of the hash, the bucket with the low ones.
+struct intern_pool {
+	static const int shard_bits = 6;
+
+	template<typename _Rep>
+	static intern_shard<_Rep>* shards()
+	{
+		// never freed, so strings in static objects can outlive every other static
+		static intern_shard<_Rep>* s = new intern_shard<_Rep>[1 << shard_bits];
+		return s;
+	}
+
+	template<typename _Rep>
+	static intern_shard<_Rep>& shard_of(size_t hash)
+	{
+		return shards<_Rep>()[hash >> (sizeof(size_t) * 8 - shard_bits)];
+	}
+
+	template<typename _Rep>
+	static void grow(intern_shard<_Rep>& shard)
+	{
+		std::vector<_Rep*> buckets(shard.buckets.size() * 2);
+		const size_t mask = buckets.size() - 1;
+		for (size_t i = 0; i != shard.buckets.size(); ++i) {
+			for (_Rep* r = shard.buckets[i]; r;) {
+				_Rep* next = r->next_;
+				r->next_ = buckets[r->hash_ & mask];
+				buckets[r->hash_ & mask] = r;
+				r = next;
+			}
+		}
+		shard.buckets.swap(buckets);
+	}
+};
+
+interned_string::rep* interned_string::intern(const char* s, size_type n)
+{
+	if (n == 0) {
+		return 0;
+	}
+	if (n > small_string::max_length) {
+		throw std::length_error("interned_string: string too long");
+	}
+
+	const size_t hash = hash_of(s, n);
+	intern_shard<rep>& shard = intern_pool::shard_of<rep>(hash);
+	std::lock_guard<std::mutex> lock(shard.mtx);
+
+	rep** bucket = &shard.buckets[hash & (shard.buckets.size() - 1)];
+	for (rep* r = *bucket; r; r = r->next_) {
+		if (r->hash_ == hash && r->size_ == n && memcmp(r->data_, s, n) == 0) {
+			r->refs_.fetch_add(1, std::memory_order_relaxed);
+			return r;
+		}
+	}
+
+	const size_t bytes = offsetof(rep, data_) + n + 1;
+	rep* r = static_cast<rep*>(::operator new(bytes));
+	r->hash_ = hash;
+	new (&r->refs_) std::atomic<size_t>(1);
+	r->size_ = static_cast<uint32_t>(n);
+	memcpy(r->data_, s, n);
+	r->data_[n] = '\0';
+
+	if (shard.count >= shard.buckets.size()) {
+		try {
+			intern_pool::grow(shard);
+			bucket = &shard.buckets[hash & (shard.buckets.size() - 1)];
+		} catch (...) {
+			// a longer chain is fine, losing the string is not
+		}
+	}
+	r->next_ = *bucket;
+	*bucket = r;
+	++shard.count;
+	shard.bytes += bytes;
+	return r;
+}
+
+void interned_string::release_last(rep* r)
+{
+	intern_shard<rep>& shard = intern_pool::shard_of<rep>(r->hash_);
+	std::lock_guard<std::mutex> lock(shard.mtx);
+	if (r->refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		// interned again while we were waiting for the lock
+		return;
+	}
+
+	rep** p = &shard.buckets[r->hash_ & (shard.buckets.size() - 1)];
+	while (*p != r) {
+		p = &(*p)->next_;
+	}
+	*p = r->next_;
+	--shard.count;
+	shard.bytes -= offsetof(rep, data_) + r->size_ + 1;
+	::operator delete(r);
+}
+
+intern_pool_stats interned_string::pool_stats()
+{
+	intern_pool_stats stats = intern_pool_stats();
+	intern_shard<rep>* shards = intern_pool::shards<rep>();
+	for (int i = 0; i != 1 << intern_pool::shard_bits; ++i) {
+		std::lock_guard<std::mutex> lock(shards[i].mtx);
+		stats.strings += shards[i].count;
+		stats.bytes += shards[i].bytes;
+		stats.bucket_bytes += shards[i].buckets.size() * sizeof(rep*);
+	}
+	return stats;
+}
+
+}
@@ -0,0 +1,288 @@
+/**
+ * @file container/interned_string.h
+ * @brief Strings shared through a process-wide intern pool.
+ */
+
+#ifndef LIBANT_CONTAINER_INTERNED_STRING_H_
+#define LIBANT_CONTAINER_INTERNED_STRING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "small_string.h"
+
+namespace ant {
+
+/**
+ * @brief Bytes and strings held by the intern pool.
+ */
+struct intern_pool_stats {
+	size_t	strings;
+	/// Bytes of the pooled strings and their headers, excluding the bucket arrays.
+	size_t	bytes;
+	size_t	bucket_bytes;
+};
+
+/**
+ * @brief An immutable string whose characters live in a process-wide intern pool.
+ *
+ * Constructing an interned_string looks its characters up in the pool and
+ * shares the buffer already there, or adds one; all interned_strings with
+ * the same characters point at the same buffer. That makes them cheap to
+ * keep in containers with many repeated keys, as each distinct string is
+ * stored once however many containers hold it:
+ *
+ *     ant::linked_map<ant::interned_string, int> m;
+ *     m[ant::interned_string("tenant-42")] = 1;
+ *
+ * Equality is a pointer comparison and hash() returns the hash computed when
+ * the string was interned. Ordering compares bytes, like small_string.
+ *
+ * Buffers are reference counted and leave the pool with their last
+ * interned_string. The pool is split into shards with a lock each, so
+ * threads interning different strings rarely contend; copying and
+ * destroying an interned_string only touches its own reference count,
+ * except for the last reference, which takes the shard lock to remove it.
+ * The empty string is never pooled.
+ */
+class interned_string {
+public:
+	typedef size_t size_type;
+
+public:
+	interned_string() : rep_(0)
+	{
+	}
+
+	explicit interned_string(const char* s)
+	{
+		rep_ = intern(s, strlen(s));
+	}
+
+	interned_string(const char* s, size_type n)
+	{
+		rep_ = intern(s, n);
+	}
+
+	explicit interned_string(const std::string& s)
+	{
+		rep_ = intern(s.data(), s.size());
+	}
+
+	explicit interned_string(const small_string& s)
+	{
+		rep_ = intern(s.data(), s.size());
+	}
+
+	interned_string(const interned_string& rhs) : rep_(rhs.rep_)
+	{
+		if (rep_) {
+			rep_->refs_.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	interned_string(interned_string&& rhs) noexcept : rep_(rhs.rep_)
+	{
+		rhs.rep_ = 0;
+	}
+
+	~interned_string()
+	{
+		if (rep_) {
+			release(rep_);
+		}
+	}
+
+	const interned_string& operator=(const interned_string& rhs)
+	{
+		interned_string(rhs).swap(*this);
+		return *this;
+	}
+
+	const interned_string& operator=(interned_string&& rhs) noexcept
+	{
+		interned_string(std::move(rhs)).swap(*this);
+		return *this;
+	}
+
+	void swap(interned_string& rhs) noexcept
+	{
+		rep* tmp = rep_;
+		rep_ = rhs.rep_;
+		rhs.rep_ = tmp;
+	}
+
+	friend void swap(interned_string& lhs, interned_string& rhs) noexcept
+	{
+		lhs.swap(rhs);
+	}
+
+	size_type size() const
+	{
+		return rep_ ? rep_->size_ : 0;
+	}
+
+	bool empty() const
+	{
+		return rep_ == 0;
+	}
+
+	/**
+	 * @return the null-terminated characters, never null
+	 */
+	const char* c_str() const
+	{
+		return rep_ ? rep_->data_ : "";
+	}
+
+	const char* data() const
+	{
+		return c_str();
+	}
+
+	/**
+	 * @return the hash of the characters, computed once when they were interned
+	 */
+	size_t hash() const
+	{
+		return rep_ ? rep_->hash_ : empty_hash();
+	}
+
+	/**
+	 * @return <0, 0 or >0 as *this orders before, equal to or after rhs, in the order of small_string
+	 */
+	int compare(const interned_string& rhs) const
+	{
+		if (rep_ == rhs.rep_) {
+			return 0;
+		}
+		const size_type lsize = size();
+		const size_type rsize = rhs.size();
+		int r = memcmp(c_str(), rhs.c_str(), lsize < rsize ? lsize : rsize);
+		if (r) {
+			return r;
+		}
+		return lsize < rsize ? -1 : 1;
+	}
+
+	small_string str() const
+	{
+		return small_string(c_str(), size());
+	}
+
+	/**
+	 * @return a snapshot of the pool's size, taken shard by shard
+	 */
+	static intern_pool_stats pool_stats();
+
+	/**
+	 * @return hash of the characters, as interned_string::hash() would return for them
+	 */
+	static size_t hash_of(const char* s, size_type n)
+	{
+		return hash_bytes(s, n, 0xc70f6907UL);
+	}
+
+	friend bool operator==(const interned_string& lhs, const interned_string& rhs)
+	{
+		return lhs.rep_ == rhs.rep_;
+	}
+
+	friend bool operator!=(const interned_string& lhs, const interned_string& rhs)
+	{
+		return lhs.rep_ != rhs.rep_;
+	}
+
+	friend bool operator<(const interned_string& lhs, const interned_string& rhs)
+	{
+		return lhs.compare(rhs) < 0;
+	}
+
+	friend bool operator>(const interned_string& lhs, const interned_string& rhs)
+	{
+		return lhs.compare(rhs) > 0;
+	}
+
+	friend bool operator<=(const interned_string& lhs, const interned_string& rhs)
+	{
+		return lhs.compare(rhs) <= 0;
+	}
+
+	friend bool operator>=(const interned_string& lhs, const interned_string& rhs)
+	{
+		return lhs.compare(rhs) >= 0;
+	}
+
+	friend std::ostream& operator<<(std::ostream& out, const interned_string& s)
+	{
+		return out.write(s.c_str(), s.size());
+	}
+
+private:
+	// A pooled string, allocated with its characters in one block.
+	struct rep {
+		rep*					next_;		// next in the shard's bucket
+		size_t					hash_;
+		std::atomic<size_t>		refs_;
+		uint32_t				size_;
+		char					data_[1];
+	};
+
+	static size_t empty_hash()
+	{
+		static const size_t h = hash_of("", 0);
+		return h;
+	}
+
+	/**
+	 * @return the pooled copy of s with a reference taken for the caller, null if n is 0
+	 * @throw std::length_error if n exceeds small_string::max_length
+	 */
+	static rep* intern(const char* s, size_type n);
+
+	static void release(rep* r)
+	{
+		// Only the last reference goes through the pool, under the shard lock,
+		// so a string can't be found and revived while it is being freed.
+		size_t refs = r->refs_.load(std::memory_order_relaxed);
+		while (refs > 1) {
+			if (r->refs_.compare_exchange_weak(refs, refs - 1, std::memory_order_release,
+											   std::memory_order_relaxed)) {
+				return;
+			}
+		}
+		release_last(r);
+	}
+
+	static void release_last(rep* r);
+
+private:
+	rep*	rep_;
+};
+
+/**
+ * @return 0; the characters belong to the intern pool, see interned_string::pool_stats()
+ */
+inline size_t heap_bytes(const interned_string&)
+{
+	return 0;
+}
+
+}
+
+namespace std {
+
+template<>
+struct hash<ant::interned_string> {
+	size_t operator()(const ant::interned_string& s) const
+	{
+		return s.hash();
+	}
+};
+
+}
+
+#endif // LIBANT_CONTAINER_INTERNED_STRING_H_
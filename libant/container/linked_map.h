@@ -154,7 +154,12 @@ public:
 
 private:
 	/// This turns a red-black tree into a linked_map.
+#if __cplusplus >= 201103L
+	typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<value_type> _Pair_alloc_type;
+	typedef std::allocator_traits<_Pair_alloc_type> _Pair_alloc_traits;
+#else
 	typedef typename _Alloc::template rebind<value_type>::other _Pair_alloc_type;
+#endif
 
 	typedef _Rb_tree<key_type, value_type, _Select1st<value_type>, key_compare,
 	        _Pair_alloc_type> _Rep_type;
@@ -165,10 +170,17 @@ private:
 public:
 	// many of these are specified differently in ISO, but the following are
 	// "functionally equivalent"
+#if __cplusplus >= 201103L
+	typedef typename _Pair_alloc_traits::pointer pointer;
+	typedef typename _Pair_alloc_traits::const_pointer const_pointer;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+#else
 	typedef typename _Pair_alloc_type::pointer pointer;
 	typedef typename _Pair_alloc_type::const_pointer const_pointer;
 	typedef typename _Pair_alloc_type::reference reference;
 	typedef typename _Pair_alloc_type::const_reference const_reference;
+#endif
 	typedef typename _Rep_type::iterator iterator;
 	typedef typename _Rep_type::const_iterator const_iterator;
 	typedef typename _Rep_type::size_type size_type;
@@ -214,6 +226,64 @@ public:
 	{
 	}
 
+#if __cplusplus >= 201103L
+	/**
+	 *  @brief  Creates a %linked_map with no elements.
+	 *  @param  __a  An allocator object.
+	 */
+	explicit linked_map(const allocator_type& __a) :
+			_M_t(_Compare(), _Pair_alloc_type(__a))
+	{
+	}
+
+	/**
+	 *  @brief  Allocator-extended copy constructor.
+	 *  @param  __x  A %linked_map of identical element and allocator types.
+	 *  @param  __a  An allocator object.
+	 */
+	linked_map(const linked_map& __x, const allocator_type& __a) :
+			_M_t(__x._M_t, _Pair_alloc_type(__a))
+	{
+	}
+
+	/**
+	 *  @brief  Allocator-extended move constructor.
+	 *  @param  __x  A %linked_map of identical element and allocator types.
+	 *  @param  __a  An allocator object.
+	 *
+	 *  The nodes of @a __x are taken over if @a __a compares equal to its
+	 *  allocator; otherwise its elements are moved one by one.
+	 */
+	linked_map(linked_map&& __x, const allocator_type& __a) :
+			_M_t(std::move(__x._M_t), _Pair_alloc_type(__a))
+	{
+	}
+
+	/**
+	 *  @brief  Allocator-extended initializer_list constructor.
+	 *  @param  __l  An initializer_list.
+	 *  @param  __a  An allocator object.
+	 */
+	linked_map(std::initializer_list<value_type> __l, const allocator_type& __a) :
+			_M_t(_Compare(), _Pair_alloc_type(__a))
+	{
+		_M_t._M_insert_unique(__l.begin(), __l.end());
+	}
+
+	/**
+	 *  @brief  Allocator-extended range constructor.
+	 *  @param  __first  An input iterator.
+	 *  @param  __last  An input iterator.
+	 *  @param  __a  An allocator object.
+	 */
+	template<typename _InputIterator>
+	linked_map(_InputIterator __first, _InputIterator __last, const allocator_type& __a) :
+			_M_t(_Compare(), _Pair_alloc_type(__a))
+	{
+		_M_t._M_insert_unique(__first, __last);
+	}
+#endif
+
 #if __cplusplus >= 201103L
 	/**
 	 *  @brief  %Map move constructor.
@@ -298,8 +368,9 @@ public:
 	 *  @brief  %Map assignment operator.
 	 *  @param  __x  A %linked_map of identical element and allocator types.
 	 *
-	 *  All the elements of @a __x are copied, but unlike the copy
-	 *  constructor, the allocator object is not copied.
+	 *  All the elements of @a __x are copied.  In C++11 and later the
+	 *  allocator object is copied too if it propagates on copy assignment,
+	 *  after the old elements have been freed with the old one.
 	 */
 	linked_map&
 	operator=(const linked_map& __x)
@@ -321,8 +392,7 @@ public:
 	{
 		// NB: DR 1204.
 		// NB: DR 675.
-		this->clear();
-		this->swap(__x);
+		_M_t._M_move_assign(__x._M_t);
 		return *this;
 	}
 
@@ -612,6 +682,28 @@ public:
 		return _M_t.max_size();
 	}
 
+	/**
+	 *  @brief  Reports the memory used by the %linked_map.
+	 *
+	 *  The result splits the footprint into tree links, insertion-order
+	 *  links, the elements themselves, memory the elements own on the heap
+	 *  (as reported by heap_bytes()) and slack such as padding and
+	 *  allocator overhead.  Takes linear time.
+	 */
+	container_memory_usage memory_usage() const
+	{
+		return _M_t.memory_usage();
+	}
+
+	/**
+	 *  Returns the bytes each element costs beyond sizeof(value_type):
+	 *  links, padding and estimated allocator overhead.
+	 */
+	static size_type node_overhead()
+	{
+		return _Rep_type::node_overhead();
+	}
+
 	// [23.3.1.2] element access
 	/**
 	 *  @brief  Subscript ( @c [] ) access to %linked_map data.
@@ -631,7 +723,8 @@ public:
 		// concept requirements
 		__glibcxx_function_requires(_DefaultConstructibleConcept<mapped_type>)
 
-		iterator __i = lower_bound(__k);
+		// A key greater than every key present is appended without a descent.
+		iterator __i = _M_t._M_past_rightmost(__k) ? end() : lower_bound(__k);
 		// __i->first is greater than or equivalent to __k.
 		if (__i == end() || key_comp()(__k, (*__i).first))
 #if __cplusplus >= 201103L
@@ -650,7 +743,8 @@ public:
 		// concept requirements
 		__glibcxx_function_requires(_DefaultConstructibleConcept<mapped_type>)
 
-		iterator __i = lower_bound(__k);
+		// A key greater than every key present is appended without a descent.
+		iterator __i = _M_t._M_past_rightmost(__k) ? end() : lower_bound(__k);
 		// __i->first is greater than or equivalent to __k.
 		if (__i == end() || key_comp()(__k, (*__i).first))
 			__i = _M_t._M_emplace_hint_unique(__i, std::piecewise_construct,
@@ -983,6 +1077,24 @@ public:
 		_M_t.swap(__x._M_t);
 	}
 
+	/**
+	 *  @brief  Moves an element to the end of the insertion order.
+	 *  @param  __position  An iterator pointing to the element.
+	 *
+	 *  The element becomes the newest one, as if it had just been
+	 *  inserted; its place in key order is unchanged.  Takes constant time
+	 *  and invalidates no iterators.
+	 */
+	void move_to_last(const_iterator __position)
+	{
+		_M_t.move_to_last(__position);
+	}
+
+	void move_to_last(const_link_iterator __position)
+	{
+		_M_t.move_to_last(__position);
+	}
+
 	/**
 	 *  Erases all elements in a %linked_map.  Note that this function only
 	 *  erases the elements, and that if the elements themselves are
@@ -994,6 +1106,146 @@ public:
 		_M_t.clear();
 	}
 
+#if __cplusplus >= 201103L
+	/**
+	 *  @brief  Moves all elements into one contiguous block of memory.
+	 *  @param  __order  Lay the block out in insertion order (link_order)
+	 *                   or in ascending key order (key_order).
+	 *
+	 *  After a long run of insertions and erasures the nodes of a
+	 *  %linked_map are scattered over the heap and every step of a full scan
+	 *  misses the cache.  This function relocates all nodes back to back
+	 *  in the requested order and rebuilds the tree perfectly balanced, so
+	 *  a scan in that order walks memory sequentially.  Insertion order is
+	 *  preserved.  The block is released when its last element is erased.
+	 *
+	 *  All iterators, pointers and references are invalidated.  Takes
+	 *  linear time and, if relocating an element throws, leaves the
+	 *  %linked_map unchanged.
+	 */
+	void compact(compact_order __order = link_order)
+	{
+		_M_t.compact(__order);
+	}
+#endif
+
+	/**
+	 *  @brief  Cuts the %linked_map into ranges of similar size.
+	 *  @param  __parts  The number of ranges wanted.
+	 *  @return  Ascending key-order iterators, starting with begin() and
+	 *           ending with end(); each adjacent pair delimits one range.
+	 *
+	 *  The cuts are the nodes of the top levels of the tree, so the
+	 *  function takes O(__parts) time and the number of ranges is
+	 *  __parts rounded to a power of two, or fewer for a small %linked_map.
+	 *  Used by the parallel algorithms in container/parallel.h.
+	 */
+	std::vector<iterator> split(size_type __parts)
+	{
+		return _M_t.template _M_split<iterator>(__parts);
+	}
+
+	std::vector<const_iterator> split(size_type __parts) const
+	{
+		return _M_t.template _M_split<const_iterator>(__parts);
+	}
+
+	// bulk traversal
+	/**
+	 *  @brief  Applies a function to every pair in ascending key order.
+	 *  @param  __f  A unary function object taking a reference to value_type.
+	 *  @return  @a __f, after it has been applied to every pair.
+	 *
+	 *  Equivalent to std::for_each(begin(), end(), __f), but the traversal
+	 *  prefetches nodes several steps ahead of the one being visited.  The
+	 *  nodes are still reached one dependent load at a time, so this only
+	 *  pays off when @a __f does enough work per element to overlap with the
+	 *  misses; a bare summing loop over a large %linked_map runs no faster.
+	 *  @a __f must not insert or erase elements.
+	 */
+	template<typename _Function>
+	_Function for_each(_Function __f)
+	{
+		_M_t.for_each(__f);
+		return __f;
+	}
+
+	template<typename _Function>
+	_Function for_each(_Function __f) const
+	{
+		_M_t.for_each(__f);
+		return __f;
+	}
+
+	/**
+	 *  @brief  Applies a function to every pair in insertion order.
+	 *  @param  __f  A unary function object taking a reference to value_type.
+	 *  @return  @a __f, after it has been applied to every pair.
+	 *
+	 *  Equivalent to std::for_each(link_begin(), link_end(), __f), with the
+	 *  same prefetching as for_each().  @a __f must not insert or erase
+	 *  elements.
+	 */
+	template<typename _Function>
+	_Function for_each_link(_Function __f)
+	{
+		_M_t.for_each_link(__f);
+		return __f;
+	}
+
+	template<typename _Function>
+	_Function for_each_link(_Function __f) const
+	{
+		_M_t.for_each_link(__f);
+		return __f;
+	}
+
+	/**
+	 *  @brief  Hands the pairs to a function in groups, in ascending key order.
+	 *  @param  __f  A function object called as __f(__values, __n), where
+	 *               @a __values is an array of @a __n pointers to value_type.
+	 *  @return  @a __f, after it has been applied to every group.
+	 *
+	 *  Groups hold up to 16 pairs; only the last one may be smaller.  Lets
+	 *  @a __f work on several independent elements at once.  @a __f must not
+	 *  insert or erase elements.
+	 */
+	template<typename _Function>
+	_Function for_each_batch(_Function __f)
+	{
+		_M_t.for_each_batch(__f);
+		return __f;
+	}
+
+	template<typename _Function>
+	_Function for_each_batch(_Function __f) const
+	{
+		_M_t.for_each_batch(__f);
+		return __f;
+	}
+
+	/**
+	 *  @brief  Hands the pairs to a function in groups, in insertion order.
+	 *  @param  __f  A function object called as __f(__values, __n), where
+	 *               @a __values is an array of @a __n pointers to value_type.
+	 *  @return  @a __f, after it has been applied to every group.
+	 *
+	 *  See for_each_batch().
+	 */
+	template<typename _Function>
+	_Function for_each_link_batch(_Function __f)
+	{
+		_M_t.for_each_link_batch(__f);
+		return __f;
+	}
+
+	template<typename _Function>
+	_Function for_each_link_batch(_Function __f) const
+	{
+		_M_t.for_each_link_batch(__f);
+		return __f;
+	}
+
 	// observers
 	/**
 	 *  Returns the key comparison object out of which the %linked_map was
@@ -1154,6 +1406,74 @@ public:
 		return _M_t.equal_range(__x);
 	}
 
+#if __cplusplus >= 201103L
+	//@{
+	/**
+	 *  @brief  Lookups by any key the comparison object compares with key_type.
+	 *
+	 *  Available when the comparison object declares @c is_transparent, like
+	 *  small_string_less, so a key held in some other form, say a
+	 *  small_string_ref into a network buffer, is looked up without
+	 *  constructing a key_type.
+	 */
+	template<typename _Kt>
+	auto find(const _Kt& __x) -> decltype(iterator(_M_t._M_find_tr(__x)))
+	{
+		return iterator(_M_t._M_find_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto find(const _Kt& __x) const -> decltype(const_iterator(_M_t._M_find_tr(__x)))
+	{
+		return const_iterator(_M_t._M_find_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto count(const _Kt& __x) const -> decltype(_M_t._M_count_tr(__x))
+	{
+		return _M_t._M_count_tr(__x);
+	}
+
+	template<typename _Kt>
+	auto lower_bound(const _Kt& __x) -> decltype(iterator(_M_t._M_lower_bound_tr(__x)))
+	{
+		return iterator(_M_t._M_lower_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto lower_bound(const _Kt& __x) const -> decltype(const_iterator(_M_t._M_lower_bound_tr(__x)))
+	{
+		return const_iterator(_M_t._M_lower_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto upper_bound(const _Kt& __x) -> decltype(iterator(_M_t._M_upper_bound_tr(__x)))
+	{
+		return iterator(_M_t._M_upper_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto upper_bound(const _Kt& __x) const -> decltype(const_iterator(_M_t._M_upper_bound_tr(__x)))
+	{
+		return const_iterator(_M_t._M_upper_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto equal_range(const _Kt& __x) -> decltype(std::pair<iterator, iterator>(
+	        _M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x)))
+	{
+		return std::pair<iterator, iterator>(_M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto equal_range(const _Kt& __x) const -> decltype(std::pair<const_iterator, const_iterator>(
+	        _M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x)))
+	{
+		return std::pair<const_iterator, const_iterator>(_M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x));
+	}
+	//@}
+#endif
+
 	template<typename _K1, typename _T1, typename _C1, typename _A1>
 	friend bool
 	operator==(const linked_map<_K1, _T1, _C1, _A1>&,
@@ -1239,6 +1559,17 @@ inline void swap(linked_map<_Key, _Tp, _Compare, _Alloc>& __x,
 	__x.swap(__y);
 }
 
+#if __cplusplus >= 201703L
+namespace pmr {
+
+/// %linked_map allocating from a std::pmr::memory_resource.
+template<typename _Key, typename _Tp, typename _Compare = std::less<_Key> >
+using linked_map = ant::linked_map<_Key, _Tp, _Compare,
+                                   std::pmr::polymorphic_allocator<std::pair<const _Key, _Tp> > >;
+
+} // namespace pmr
+#endif
+
 } // namespace ant
 
 #endif /* LIBANT_CONTAINER_LINKED_MAP_H_ */
@@ -0,0 +1,82 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "linked_map_io.h"
+
+namespace ant {
+
+void mapped_file::open(const std::string& path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw std::runtime_error("mapped_file: can't open " + path + ": " + strerror(errno));
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int err = errno;
+		::close(fd);
+		throw std::runtime_error("mapped_file: can't stat " + path + ": " + strerror(err));
+	}
+
+	void* p = 0;
+	size_t size = st.st_size;
+	if (size) {
+		p = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) {
+			int err = errno;
+			::close(fd);
+			throw std::runtime_error("mapped_file: can't map " + path + ": " + strerror(err));
+		}
+	}
+	// the mapping keeps the file referenced
+	::close(fd);
+
+	close();
+	data_ = static_cast<const char*>(p);
+	size_ = size;
+}
+
+void mapped_file::close()
+{
+	if (data_) {
+		munmap(const_cast<char*>(data_), size_);
+		data_ = 0;
+		size_ = 0;
+	}
+}
+
+const linked_map_file_header& check_linked_map_file(const char* data, size_t size, uint32_t keyTag, uint32_t valueTag)
+{
+	if (size < sizeof(linked_map_file_header)) {
+		throw std::runtime_error("linked_map file: truncated header");
+	}
+
+	const linked_map_file_header& hdr = *reinterpret_cast<const linked_map_file_header*>(data);
+	if (memcmp(hdr.magic_, "ANTLMAP", 8) != 0) {
+		throw std::runtime_error("linked_map file: bad magic");
+	}
+	if (hdr.byteOrder_ != linked_map_file_header::byte_order_mark) {
+		throw std::runtime_error("linked_map file: written on a host of another byte order");
+	}
+	if (hdr.version_ != linked_map_file_header::current_version) {
+		throw std::runtime_error("linked_map file: unsupported version");
+	}
+	if (hdr.keyTag_ != keyTag || hdr.valueTag_ != valueTag) {
+		throw std::runtime_error("linked_map file: written for other key or value types");
+	}
+	// no arithmetic on the header's fields before they are known to lie within the file
+	if (hdr.fileSize_ != size || hdr.recordsOffset_ != sizeof(hdr) || hdr.indexOffset_ < hdr.recordsOffset_
+			|| hdr.indexOffset_ > size || hdr.indexOffset_ % 8 != 0
+			|| (size - hdr.indexOffset_) % sizeof(uint64_t) != 0
+			|| (size - hdr.indexOffset_) / sizeof(uint64_t) != hdr.count_) {
+		throw std::runtime_error("linked_map file: inconsistent layout");
+	}
+	return hdr;
+}
+
+}
@@ -0,0 +1,673 @@
+/**
+ * @file container/linked_map_io.h
+ * @brief Binary serialization of linked_map and a zero-copy view over mapped files.
+ *
+ * File layout, all integers in host byte order:
+ *
+ *     header     linked_map_file_header, 64 bytes
+ *     records    one per element in insertion order: uint32 key length,
+ *                uint32 value length, key bytes, value bytes, zero padded
+ *                to a multiple of 8 bytes
+ *     index      uint64 offset of every record, sorted by key
+ *
+ * Keys and values are encoded with binary_codec, which handles trivially
+ * copyable types, std::string and small_string out of the box and can be
+ * specialized for other types.
+ */
+
+#ifndef LIBANT_CONTAINER_LINKED_MAP_IO_H_
+#define LIBANT_CONTAINER_LINKED_MAP_IO_H_
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "linked_map.h"
+#include "small_string.h"
+
+namespace ant {
+
+/**
+ * @brief A string stored in a mapped file, or any other borrowed character range.
+ */
+class mapped_string {
+public:
+	mapped_string() : data_(""), size_(0)
+	{
+	}
+
+	mapped_string(const char* data, size_t size) : data_(data), size_(size)
+	{
+	}
+
+	mapped_string(const char* s) : data_(s), size_(strlen(s))
+	{
+	}
+
+	mapped_string(const std::string& s) : data_(s.data()), size_(s.size())
+	{
+	}
+
+	mapped_string(const small_string& s) : data_(s.data()), size_(s.size())
+	{
+	}
+
+	const char* data() const
+	{
+		return data_;
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	std::string str() const
+	{
+		return std::string(data_, size_);
+	}
+
+	/**
+	 * @return <0, 0 or >0 as *this orders before, equal to or after rhs, comparing bytes as unsigned char
+	 */
+	int compare(const mapped_string& rhs) const
+	{
+		int r = memcmp(data_, rhs.data_, std::min(size_, rhs.size_));
+		if (r != 0) {
+			return r;
+		}
+		return size_ < rhs.size_ ? -1 : (size_ > rhs.size_ ? 1 : 0);
+	}
+
+	friend bool operator==(const mapped_string& lhs, const mapped_string& rhs)
+	{
+		return lhs.size_ == rhs.size_ && memcmp(lhs.data_, rhs.data_, lhs.size_) == 0;
+	}
+
+	friend bool operator!=(const mapped_string& lhs, const mapped_string& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	friend bool operator<(const mapped_string& lhs, const mapped_string& rhs)
+	{
+		return lhs.compare(rhs) < 0;
+	}
+
+private:
+	const char*	data_;
+	size_t		size_;
+};
+
+/**
+ * @brief Byte-wise ordering of string keys, the order of std::less<std::string>.
+ */
+struct mapped_string_less {
+	bool operator()(const mapped_string& lhs, const mapped_string& rhs) const
+	{
+		return lhs.compare(rhs) < 0;
+	}
+};
+
+/**
+ * @brief Encodes values of _Tp for save_linked_map() and decodes them from a file.
+ *
+ * A codec provides:
+ *
+ *     static const uint32_t tag;                         // recorded in the file header and checked on load
+ *     typedef ... view_type;                             // what a linked_map_view hands out, read straight from the file
+ *     typedef ... compare_type;                          // ordering of view_type against _Tp, used by linked_map_view::find()
+ *     static size_t size(const _Tp& v);                  // encoded size of v
+ *     static void encode(const _Tp& v, char* out);       // writes size(v) bytes
+ *     static view_type view(const char* p, size_t n);     // reads the n bytes at p, throws std::runtime_error
+ *     static _Tp decode(const char* p, size_t n);         //   if n isn't a size encode() can write
+ */
+template<typename _Tp, typename _Enable = void>
+struct binary_codec;
+
+/**
+ * @brief Tag binary_codec records for a trivially copyable _Tp: its kind and its size.
+ *
+ * bool, signed and unsigned integers, floating point types and enums get
+ * kinds of their own, so a file of int can't be opened as one of float or
+ * unsigned. Other trivially copyable types share a kind and are told apart
+ * by size only; specialize this with a value of 0x10000000 or more to give
+ * such a type a tag of its own.
+ */
+template<typename _Tp>
+struct binary_type_tag {
+	static_assert(sizeof(_Tp) < 0x1000000, "binary_type_tag: type too large");
+
+	static const uint32_t kind = std::is_same<_Tp, bool>::value ? 1
+			: std::is_integral<_Tp>::value ? (std::is_signed<_Tp>::value ? 2 : 3)
+			: std::is_floating_point<_Tp>::value ? 4
+			: std::is_enum<_Tp>::value ? 5
+			: 6;
+	static const uint32_t value = (kind << 24) | sizeof(_Tp);
+};
+
+template<typename _Tp>
+struct binary_codec<_Tp, typename std::enable_if<std::is_trivially_copyable<_Tp>::value>::type> {
+	static const uint32_t tag = binary_type_tag<_Tp>::value;
+
+	typedef _Tp view_type;
+	typedef std::less<_Tp> compare_type;
+
+	static size_t size(const _Tp&)
+	{
+		return sizeof(_Tp);
+	}
+
+	static void encode(const _Tp& v, char* out)
+	{
+		memcpy(out, &v, sizeof(_Tp));
+	}
+
+	static view_type view(const char* p, size_t n)
+	{
+		if (n != sizeof(_Tp)) {
+			throw std::runtime_error("binary_codec: encoded size doesn't match the type");
+		}
+		_Tp v;
+		memcpy(&v, p, sizeof(_Tp)); // records are only 8-byte aligned
+		return v;
+	}
+
+	static _Tp decode(const char* p, size_t n)
+	{
+		return view(p, n);
+	}
+};
+
+template<typename _Str>
+struct _Binary_string_codec {
+	static const uint32_t tag = 0x20000;
+
+	typedef mapped_string view_type;
+	typedef mapped_string_less compare_type;
+
+	static size_t size(const _Str& s)
+	{
+		return s.size();
+	}
+
+	static void encode(const _Str& s, char* out)
+	{
+		if (s.size()) {
+			memcpy(out, s.c_str(), s.size());
+		}
+	}
+
+	static view_type view(const char* p, size_t n)
+	{
+		return mapped_string(p, n);
+	}
+
+	static _Str decode(const char* p, size_t n)
+	{
+		return _Str(std::string(p, n));
+	}
+};
+
+template<>
+struct binary_codec<std::string> : _Binary_string_codec<std::string> {
+};
+
+template<>
+struct binary_codec<small_string> : _Binary_string_codec<small_string> {
+};
+
+/**
+ * @brief Header of a serialized linked_map.
+ */
+struct linked_map_file_header {
+	static const uint32_t current_version = 2;
+	static const uint32_t byte_order_mark = 0x01020304;
+
+	char		magic_[8];		// "ANTLMAP"
+	uint32_t	version_;
+	uint32_t	byteOrder_;		// byte_order_mark as written by the host
+	uint32_t	keyTag_;		// binary_codec<key_type>::tag
+	uint32_t	valueTag_;		// binary_codec<mapped_type>::tag
+	uint64_t	count_;
+	uint64_t	recordsOffset_;
+	uint64_t	indexOffset_;
+	uint64_t	fileSize_;
+	char		reserved_[8];
+};
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ */
+class mapped_file {
+public:
+	mapped_file() : data_(0), size_(0)
+	{
+	}
+
+	~mapped_file()
+	{
+		close();
+	}
+
+	mapped_file(mapped_file&& rhs) noexcept : data_(rhs.data_), size_(rhs.size_)
+	{
+		rhs.data_ = 0;
+		rhs.size_ = 0;
+	}
+
+	mapped_file& operator=(mapped_file&& rhs) noexcept
+	{
+		std::swap(data_, rhs.data_);
+		std::swap(size_, rhs.size_);
+		return *this;
+	}
+
+	/**
+	 * @throw std::runtime_error if the file can't be opened or mapped
+	 */
+	void open(const std::string& path);
+	void close();
+
+	const char* data() const
+	{
+		return data_;
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+private:
+	mapped_file(const mapped_file&);
+	mapped_file& operator=(const mapped_file&);
+
+private:
+	const char*	data_;
+	size_t		size_;
+};
+
+/**
+ * @brief Checks the header of a mapped linked_map file, and that the index it describes fits in the file.
+ *
+ * The records and the offsets in the index are not read; linked_map_record() checks each one when it is used.
+ *
+ * @return the validated header
+ * @throw std::runtime_error if the file is truncated, of another version or byte order, or was written for other key or value types
+ */
+const linked_map_file_header& check_linked_map_file(const char* data, size_t size, uint32_t keyTag, uint32_t valueTag);
+
+/**
+ * @brief Checks that the record at offset off of a file validated by check_linked_map_file() lies within the records.
+ * @return the record
+ * @throw std::runtime_error if the record starts or ends outside the records, or is misaligned
+ */
+inline const char* linked_map_record(const char* data, const linked_map_file_header& hdr, uint64_t off)
+{
+	if (off < hdr.recordsOffset_ || off > hdr.indexOffset_ || off % 8 != 0 || hdr.indexOffset_ - off < 8) {
+		throw std::runtime_error("linked_map file: record offset out of bounds");
+	}
+	uint32_t klen, vlen;
+	memcpy(&klen, data + off, 4);
+	memcpy(&vlen, data + off + 4, 4);
+	if (uint64_t(klen) + vlen > hdr.indexOffset_ - off - 8) {
+		throw std::runtime_error("linked_map file: record runs past the records");
+	}
+	return data + off;
+}
+
+/**
+ * @brief Writes m to os in insertion order, followed by an index sorted by key.
+ * @throw std::length_error if a key or value encodes to 4G or more
+ * @throw std::runtime_error if writing fails
+ */
+template<typename _Key, typename _Tp, typename _Compare, typename _Alloc>
+void save_linked_map(const linked_map<_Key, _Tp, _Compare, _Alloc>& m, std::ostream& os)
+{
+	typedef linked_map<_Key, _Tp, _Compare, _Alloc> map_type;
+	typedef binary_codec<_Key> key_codec;
+	typedef binary_codec<_Tp> value_codec;
+
+	// offset of every record, keyed by element address for the index pass below
+	std::vector<std::pair<const void*, uint64_t> > offsets;
+	offsets.reserve(m.size());
+	uint64_t off = sizeof(linked_map_file_header);
+	size_t maxRecord = 0;
+	for (typename map_type::const_link_iterator it = m.link_begin(); it != m.link_end(); ++it) {
+		size_t klen = key_codec::size(it->first);
+		size_t vlen = value_codec::size(it->second);
+		if (klen > UINT32_MAX || vlen > UINT32_MAX) {
+			throw std::length_error("save_linked_map: element too large");
+		}
+		size_t rlen = (8 + klen + vlen + 7) & ~size_t(7);
+		offsets.push_back(std::make_pair(static_cast<const void*>(&*it), off));
+		off += rlen;
+		if (rlen > maxRecord) {
+			maxRecord = rlen;
+		}
+	}
+
+	linked_map_file_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic_, "ANTLMAP", 8);
+	hdr.version_ = linked_map_file_header::current_version;
+	hdr.byteOrder_ = linked_map_file_header::byte_order_mark;
+	hdr.keyTag_ = key_codec::tag;
+	hdr.valueTag_ = value_codec::tag;
+	hdr.count_ = m.size();
+	hdr.recordsOffset_ = sizeof(hdr);
+	hdr.indexOffset_ = off;
+	hdr.fileSize_ = off + m.size() * sizeof(uint64_t);
+	os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+	std::vector<char> buf(maxRecord);
+	for (typename map_type::const_link_iterator it = m.link_begin(); it != m.link_end(); ++it) {
+		uint32_t klen = key_codec::size(it->first);
+		uint32_t vlen = value_codec::size(it->second);
+		size_t rlen = (8 + klen + vlen + 7) & ~size_t(7);
+		memset(&buf[0], 0, rlen);
+		memcpy(&buf[0], &klen, 4);
+		memcpy(&buf[4], &vlen, 4);
+		key_codec::encode(it->first, &buf[8]);
+		value_codec::encode(it->second, &buf[8 + klen]);
+		os.write(&buf[0], rlen);
+	}
+
+	std::sort(offsets.begin(), offsets.end(),
+		[](const std::pair<const void*, uint64_t>& a, const std::pair<const void*, uint64_t>& b) {
+			return std::less<const void*>()(a.first, b.first);
+		});
+	std::vector<uint64_t> index;
+	index.reserve(m.size());
+	for (typename map_type::const_iterator it = m.begin(); it != m.end(); ++it) {
+		const void* p = &*it;
+		index.push_back(std::lower_bound(offsets.begin(), offsets.end(), std::make_pair(p, uint64_t(0)),
+			[](const std::pair<const void*, uint64_t>& a, const std::pair<const void*, uint64_t>& b) {
+				return std::less<const void*>()(a.first, b.first);
+			})->second);
+	}
+	if (!index.empty()) {
+		os.write(reinterpret_cast<const char*>(&index[0]), index.size() * sizeof(uint64_t));
+	}
+
+	if (!os) {
+		throw std::runtime_error("save_linked_map: write failed");
+	}
+}
+
+/**
+ * @brief Writes m to the file at path, replacing it.
+ */
+template<typename _Key, typename _Tp, typename _Compare, typename _Alloc>
+void save_linked_map(const linked_map<_Key, _Tp, _Compare, _Alloc>& m, const std::string& path)
+{
+	std::ofstream os(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!os) {
+		throw std::runtime_error("save_linked_map: can't open " + path);
+	}
+	save_linked_map(m, os);
+	os.close();
+	if (!os) {
+		throw std::runtime_error("save_linked_map: write failed on " + path);
+	}
+}
+
+/**
+ * @brief Read-only linked_map served straight from a file written by save_linked_map().
+ *
+ * Opening maps the file and checks its header, nothing is parsed, so a view
+ * over a table of any size is ready at once; pages are read in by the first
+ * lookups that touch them. Each index entry and record is checked against
+ * the bounds of the file when it is read, so a corrupt or hostile file makes
+ * the lookup or iteration reading it throw std::runtime_error rather than
+ * read outside the mapping. find() is a binary search over the key index and
+ * iteration follows the insertion order of the saved map. Elements are
+ * handed out as pairs of codec views, for strings a mapped_string pointing
+ * into the mapping, valid as long as the view stays open.
+ *
+ * _Compare must order keys the same way the comparator of the saved map did.
+ */
+template<typename _Key, typename _Tp, typename _Compare = typename binary_codec<_Key>::compare_type>
+class linked_map_view {
+public:
+	typedef binary_codec<_Key> key_codec;
+	typedef binary_codec<_Tp> value_codec;
+	typedef typename key_codec::view_type key_type;
+	typedef typename value_codec::view_type mapped_type;
+	typedef std::pair<key_type, mapped_type> value_type;
+	typedef size_t size_type;
+
+	/**
+	 * @brief Iterates in insertion order. Dereferencing decodes the record at hand.
+	 */
+	class link_iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef typename linked_map_view::value_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const value_type* pointer;
+		typedef value_type reference;
+
+		link_iterator() : data_(0), hdr_(0), rec_(0)
+		{
+		}
+
+		value_type operator*() const
+		{
+			uint32_t klen, vlen;
+			memcpy(&klen, rec_, 4);
+			memcpy(&vlen, rec_ + 4, 4);
+			return value_type(key_codec::view(rec_ + 8, klen), value_codec::view(rec_ + 8 + klen, vlen));
+		}
+
+		link_iterator& operator++()
+		{
+			uint32_t klen, vlen;
+			memcpy(&klen, rec_, 4);
+			memcpy(&vlen, rec_ + 4, 4);
+			uint64_t next = (rec_ - data_) + ((8 + uint64_t(klen) + vlen + 7) & ~uint64_t(7));
+			rec_ = next == hdr_->indexOffset_ ? data_ + next : linked_map_record(data_, *hdr_, next);
+			return *this;
+		}
+
+		link_iterator operator++(int)
+		{
+			link_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		friend bool operator==(const link_iterator& lhs, const link_iterator& rhs)
+		{
+			return lhs.rec_ == rhs.rec_;
+		}
+
+		friend bool operator!=(const link_iterator& lhs, const link_iterator& rhs)
+		{
+			return lhs.rec_ != rhs.rec_;
+		}
+
+	private:
+		link_iterator(const char* data, const linked_map_file_header* hdr, const char* rec) :
+				data_(data), hdr_(hdr), rec_(rec)
+		{
+		}
+
+		friend class linked_map_view;
+
+	private:
+		const char*						data_;
+		const linked_map_file_header*	hdr_;
+		const char*						rec_;	// a checked record, or the end of the records
+	};
+
+public:
+	linked_map_view() : hdr_(0), index_(0)
+	{
+	}
+
+	/**
+	 * @throw std::runtime_error see open()
+	 */
+	explicit linked_map_view(const std::string& path, const _Compare& comp = _Compare()) :
+			hdr_(0), index_(0), comp_(comp)
+	{
+		open(path);
+	}
+
+	/**
+	 * @brief Maps the file at path, closing the file mapped before.
+	 * @throw std::runtime_error if the file can't be mapped or wasn't written for these key and value types
+	 */
+	void open(const std::string& path)
+	{
+		mapped_file file;
+		file.open(path);
+		hdr_ = &check_linked_map_file(file.data(), file.size(), key_codec::tag, value_codec::tag);
+		index_ = reinterpret_cast<const uint64_t*>(file.data() + hdr_->indexOffset_);
+		file_ = std::move(file);
+	}
+
+	void close()
+	{
+		file_.close();
+		hdr_ = 0;
+		index_ = 0;
+	}
+
+	bool is_open() const
+	{
+		return hdr_ != 0;
+	}
+
+	size_type size() const
+	{
+		return hdr_ ? hdr_->count_ : 0;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * @throw std::runtime_error if the first record runs past the records
+	 */
+	link_iterator link_begin() const
+	{
+		if (!hdr_ || hdr_->recordsOffset_ == hdr_->indexOffset_) {
+			return link_end();
+		}
+		return at(hdr_->recordsOffset_);
+	}
+
+	link_iterator link_end() const
+	{
+		return link_iterator(file_.data(), hdr_, hdr_ ? file_.data() + hdr_->indexOffset_ : 0);
+	}
+
+	/**
+	 * @return the element with key k, or link_end()
+	 * @throw std::runtime_error if an index entry visited by the search names no valid record
+	 */
+	link_iterator find(const _Key& k) const
+	{
+		size_type lo = 0;
+		size_type hi = size();
+		while (lo < hi) {
+			size_type mid = lo + (hi - lo) / 2;
+			link_iterator it = at(index_[mid]);
+			key_type key = record_key(it.rec_);
+			if (comp_(key, k)) {
+				lo = mid + 1;
+			} else if (comp_(k, key)) {
+				hi = mid;
+			} else {
+				return it;
+			}
+		}
+		return link_end();
+	}
+
+	size_type count(const _Key& k) const
+	{
+		return find(k) != link_end();
+	}
+
+	/**
+	 * @brief Calls fn(key, value) for every element in ascending key order.
+	 * @throw std::runtime_error if an index entry names no valid record
+	 */
+	template<typename _Fn>
+	void for_each_sorted(_Fn fn) const
+	{
+		for (size_type i = 0; i != size(); ++i) {
+			value_type v = *at(index_[i]);
+			fn(v.first, v.second);
+		}
+	}
+
+private:
+	link_iterator at(uint64_t off) const
+	{
+		return link_iterator(file_.data(), hdr_, linked_map_record(file_.data(), *hdr_, off));
+	}
+
+	static key_type record_key(const char* rec)
+	{
+		uint32_t klen;
+		memcpy(&klen, rec, 4);
+		return key_codec::view(rec + 8, klen);
+	}
+
+private:
+	linked_map_view(const linked_map_view&);
+	linked_map_view& operator=(const linked_map_view&);
+
+private:
+	mapped_file						file_;
+	const linked_map_file_header*	hdr_;
+	const uint64_t*					index_;
+	_Compare						comp_;
+};
+
+/**
+ * @brief Inserts every element of the file at path into m, in the saved insertion order.
+ * @throw std::runtime_error see linked_map_view::open(), or if a record runs past the records
+ */
+template<typename _Key, typename _Tp, typename _Compare, typename _Alloc>
+void load_linked_map(const std::string& path, linked_map<_Key, _Tp, _Compare, _Alloc>& m)
+{
+	mapped_file file;
+	file.open(path);
+	const linked_map_file_header& hdr = check_linked_map_file(file.data(), file.size(),
+			binary_codec<_Key>::tag, binary_codec<_Tp>::tag);
+	uint64_t off = hdr.recordsOffset_;
+	while (off != hdr.indexOffset_) {
+		const char* rec = linked_map_record(file.data(), hdr, off);
+		uint32_t klen, vlen;
+		memcpy(&klen, rec, 4);
+		memcpy(&vlen, rec + 4, 4);
+		m.insert(std::make_pair(binary_codec<_Key>::decode(rec + 8, klen),
+								binary_codec<_Tp>::decode(rec + 8 + klen, vlen)));
+		off += (8 + uint64_t(klen) + vlen + 7) & ~uint64_t(7);
+	}
+}
+
+}
+
+#endif // LIBANT_CONTAINER_LINKED_MAP_IO_H_
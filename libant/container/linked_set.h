@@ -56,7 +56,9 @@
 #ifndef LIBANT_CONTAINER_LINKED_SET_H_
 #define LIBANT_CONTAINER_LINKED_SET_H_
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 
 #if __cplusplus >= 201103L
 #include <initializer_list>
@@ -115,18 +117,71 @@ public:
 	//@}
 
 private:
+#if __cplusplus >= 201103L
+	typedef typename std::allocator_traits<_Alloc>::template rebind_alloc<_Key> _Key_alloc_type;
+	typedef std::allocator_traits<_Key_alloc_type> _Key_alloc_traits;
+#else
 	typedef typename _Alloc::template rebind<_Key>::other _Key_alloc_type;
+#endif
 	typedef _Rb_tree<key_type, value_type, _Identity<value_type>, key_compare, _Key_alloc_type> _Rep_type;
 
 	_Rep_type _M_t;  // Red-black tree representing linked_set.
 
+	// Output iterator appending to a %linked_set whose elements arrive in
+	// ascending order.  Unlike std::insert_iterator it does not advance its
+	// hint after each insertion, which from the rightmost node would climb
+	// all the way up to the root.
+	class _Append_iterator {
+	public:
+		typedef std::output_iterator_tag iterator_category;
+		typedef void value_type;
+		typedef void difference_type;
+		typedef void pointer;
+		typedef void reference;
+
+		explicit _Append_iterator(linked_set& __s) : _M_s(&__s)
+		{
+		}
+
+		_Append_iterator& operator=(const _Key& __v)
+		{
+			_M_s->_M_t._M_insert_unique_(_M_s->_M_t.end(), __v);
+			return *this;
+		}
+
+		_Append_iterator& operator*()
+		{
+			return *this;
+		}
+
+		_Append_iterator& operator++()
+		{
+			return *this;
+		}
+
+		_Append_iterator& operator++(int)
+		{
+			return *this;
+		}
+
+	private:
+		linked_set* _M_s;
+	};
+
 public:
 	//@{
 	///  Iterator-related typedefs.
+#if __cplusplus >= 201103L
+	typedef typename _Key_alloc_traits::pointer pointer;
+	typedef typename _Key_alloc_traits::const_pointer const_pointer;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+#else
 	typedef typename _Key_alloc_type::pointer pointer;
 	typedef typename _Key_alloc_type::const_pointer const_pointer;
 	typedef typename _Key_alloc_type::reference reference;
 	typedef typename _Key_alloc_type::const_reference const_reference;
+#endif
 	typedef typename _Rep_type::const_iterator iterator;
 	typedef typename _Rep_type::const_iterator const_iterator;
 	typedef typename _Rep_type::const_reverse_iterator reverse_iterator;
@@ -204,6 +259,64 @@ public:
 	{
 	}
 
+#if __cplusplus >= 201103L
+	/**
+	 *  @brief  Creates a %linked_set with no elements.
+	 *  @param  __a  An allocator object.
+	 */
+	explicit linked_set(const allocator_type& __a)
+		: _M_t(_Compare(), _Key_alloc_type(__a))
+	{
+	}
+
+	/**
+	 *  @brief  Allocator-extended copy constructor.
+	 *  @param  __x  A %linked_set of identical element and allocator types.
+	 *  @param  __a  An allocator object.
+	 */
+	linked_set(const linked_set& __x, const allocator_type& __a)
+		: _M_t(__x._M_t, _Key_alloc_type(__a))
+	{
+	}
+
+	/**
+	 *  @brief  Allocator-extended move constructor.
+	 *  @param  __x  A %linked_set of identical element and allocator types.
+	 *  @param  __a  An allocator object.
+	 *
+	 *  The nodes of @a __x are taken over if @a __a compares equal to its
+	 *  allocator; otherwise its elements are moved one by one.
+	 */
+	linked_set(linked_set&& __x, const allocator_type& __a)
+		: _M_t(std::move(__x._M_t), _Key_alloc_type(__a))
+	{
+	}
+
+	/**
+	 *  @brief  Allocator-extended initializer_list constructor.
+	 *  @param  __l  An initializer_list.
+	 *  @param  __a  An allocator object.
+	 */
+	linked_set(std::initializer_list<value_type> __l, const allocator_type& __a)
+		: _M_t(_Compare(), _Key_alloc_type(__a))
+	{
+		_M_t._M_insert_unique(__l.begin(), __l.end());
+	}
+
+	/**
+	 *  @brief  Allocator-extended range constructor.
+	 *  @param  __first  An input iterator.
+	 *  @param  __last  An input iterator.
+	 *  @param  __a  An allocator object.
+	 */
+	template<typename _InputIterator>
+	linked_set(_InputIterator __first, _InputIterator __last, const allocator_type& __a)
+		: _M_t(_Compare(), _Key_alloc_type(__a))
+	{
+		_M_t._M_insert_unique(__first, __last);
+	}
+#endif
+
 #if __cplusplus >= 201103L
 	/**
 	 *  @brief %Set move constructor
@@ -239,8 +352,9 @@ public:
 	 *  @brief  %Set assignment operator.
 	 *  @param  __x  A %linked_set of identical element and allocator types.
 	 *
-	 *  All the elements of @a __x are copied, but unlike the copy
-	 *  constructor, the allocator object is not copied.
+	 *  All the elements of @a __x are copied.  In C++11 and later the
+	 *  allocator object is copied too if it propagates on copy assignment,
+	 *  after the old elements have been freed with the old one.
 	 */
 	linked_set& operator=(const linked_set& __x)
 	{
@@ -260,8 +374,7 @@ public:
 	{
 		// NB: DR 1204.
 		// NB: DR 675.
-		this->clear();
-		this->swap(__x);
+		_M_t._M_move_assign(__x._M_t);
 		return *this;
 	}
 
@@ -480,6 +593,28 @@ public:
 		return _M_t.max_size();
 	}
 
+	/**
+	 *  @brief  Reports the memory used by the %linked_set.
+	 *
+	 *  The result splits the footprint into tree links, insertion-order
+	 *  links, the elements themselves, memory the elements own on the heap
+	 *  (as reported by heap_bytes()) and slack such as padding and
+	 *  allocator overhead.  Takes linear time.
+	 */
+	container_memory_usage memory_usage() const
+	{
+		return _M_t.memory_usage();
+	}
+
+	/**
+	 *  Returns the bytes each element costs beyond sizeof(value_type):
+	 *  links, padding and estimated allocator overhead.
+	 */
+	static size_type node_overhead()
+	{
+		return _Rep_type::node_overhead();
+	}
+
 	/**
 	 *  @brief  Swaps data with another %linked_set.
 	 *  @param  __x  A %linked_set of the same element and allocator types.
@@ -743,6 +878,24 @@ public:
 	}
 #endif
 
+	/**
+	 *  @brief  Moves an element to the end of the insertion order.
+	 *  @param  __position  An iterator pointing to the element.
+	 *
+	 *  The element becomes the newest one, as if it had just been
+	 *  inserted; its place in key order is unchanged.  Takes constant time
+	 *  and invalidates no iterators.
+	 */
+	void move_to_last(const_iterator __position)
+	{
+		_M_t.move_to_last(__position);
+	}
+
+	void move_to_last(const_link_iterator __position)
+	{
+		_M_t.move_to_last(__position);
+	}
+
 	/**
 	 *  Erases all elements in a %linked_set.  Note that this function only erases
 	 *  the elements, and that if the elements themselves are pointers, the
@@ -754,6 +907,116 @@ public:
 		_M_t.clear();
 	}
 
+#if __cplusplus >= 201103L
+	/**
+	 *  @brief  Moves all elements into one contiguous block of memory.
+	 *  @param  __order  Lay the block out in insertion order (link_order)
+	 *                   or in ascending key order (key_order).
+	 *
+	 *  After a long run of insertions and erasures the nodes of a
+	 *  %linked_set are scattered over the heap and every step of a full scan
+	 *  misses the cache.  This function relocates all nodes back to back
+	 *  in the requested order and rebuilds the tree perfectly balanced, so
+	 *  a scan in that order walks memory sequentially.  Insertion order is
+	 *  preserved.  The block is released when its last element is erased.
+	 *
+	 *  All iterators, pointers and references are invalidated.  Takes
+	 *  linear time and, if relocating an element throws, leaves the
+	 *  %linked_set unchanged.
+	 */
+	void compact(compact_order __order = link_order)
+	{
+		_M_t.compact(__order);
+	}
+#endif
+
+	/**
+	 *  @brief  Cuts the %linked_set into ranges of similar size.
+	 *  @param  __parts  The number of ranges wanted.
+	 *  @return  Ascending key-order iterators, starting with begin() and
+	 *           ending with end(); each adjacent pair delimits one range.
+	 *
+	 *  The cuts are the nodes of the top levels of the tree, so the
+	 *  function takes O(__parts) time and the number of ranges is
+	 *  __parts rounded to a power of two, or fewer for a small %linked_set.
+	 *  Used by the parallel algorithms in container/parallel.h.
+	 */
+	std::vector<iterator> split(size_type __parts) const
+	{
+		return _M_t.template _M_split<iterator>(__parts);
+	}
+
+	// bulk traversal
+	/**
+	 *  @brief  Applies a function to every element in ascending order.
+	 *  @param  __f  A unary function object taking a const reference to
+	 *               value_type.
+	 *  @return  @a __f, after it has been applied to every element.
+	 *
+	 *  Equivalent to std::for_each(begin(), end(), __f), but the traversal
+	 *  prefetches nodes several steps ahead of the one being visited.  The
+	 *  nodes are still reached one dependent load at a time, so this only
+	 *  pays off when @a __f does enough work per element to overlap with the
+	 *  misses; a bare summing loop over a large %linked_set runs no faster.
+	 *  @a __f must not insert or erase elements.
+	 */
+	template<typename _Function>
+	_Function for_each(_Function __f) const
+	{
+		_M_t.for_each(__f);
+		return __f;
+	}
+
+	/**
+	 *  @brief  Applies a function to every element in insertion order.
+	 *  @param  __f  A unary function object taking a const reference to
+	 *               value_type.
+	 *  @return  @a __f, after it has been applied to every element.
+	 *
+	 *  Equivalent to std::for_each(link_begin(), link_end(), __f), with the
+	 *  same prefetching as for_each().  @a __f must not insert or erase
+	 *  elements.
+	 */
+	template<typename _Function>
+	_Function for_each_link(_Function __f) const
+	{
+		_M_t.for_each_link(__f);
+		return __f;
+	}
+
+	/**
+	 *  @brief  Hands the elements to a function in groups, in ascending order.
+	 *  @param  __f  A function object called as __f(__values, __n), where
+	 *               @a __values is an array of @a __n pointers to const
+	 *               value_type.
+	 *  @return  @a __f, after it has been applied to every group.
+	 *
+	 *  Groups hold up to 16 elements; only the last one may be smaller.
+	 *  @a __f must not insert or erase elements.
+	 */
+	template<typename _Function>
+	_Function for_each_batch(_Function __f) const
+	{
+		_M_t.for_each_batch(__f);
+		return __f;
+	}
+
+	/**
+	 *  @brief  Hands the elements to a function in groups, in insertion order.
+	 *  @param  __f  A function object called as __f(__values, __n), where
+	 *               @a __values is an array of @a __n pointers to const
+	 *               value_type.
+	 *  @return  @a __f, after it has been applied to every group.
+	 *
+	 *  See for_each_batch().
+	 */
+	template<typename _Function>
+	_Function for_each_link_batch(_Function __f) const
+	{
+		_M_t.for_each_link_batch(__f);
+		return __f;
+	}
+
 	// linked_set operations:
 
 	/**
@@ -861,6 +1124,138 @@ public:
 	}
 	//@}
 
+#if __cplusplus >= 201103L
+	//@{
+	/**
+	 *  @brief  Lookups by any key the comparison object compares with key_type.
+	 *
+	 *  Available when the comparison object declares @c is_transparent, like
+	 *  small_string_less, so a key held in some other form, say a
+	 *  small_string_ref into a network buffer, is looked up without
+	 *  constructing a key_type.
+	 */
+	template<typename _Kt>
+	auto find(const _Kt& __x) -> decltype(iterator(_M_t._M_find_tr(__x)))
+	{
+		return iterator(_M_t._M_find_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto find(const _Kt& __x) const -> decltype(const_iterator(_M_t._M_find_tr(__x)))
+	{
+		return const_iterator(_M_t._M_find_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto count(const _Kt& __x) const -> decltype(_M_t._M_count_tr(__x))
+	{
+		return _M_t._M_count_tr(__x);
+	}
+
+	template<typename _Kt>
+	auto lower_bound(const _Kt& __x) -> decltype(iterator(_M_t._M_lower_bound_tr(__x)))
+	{
+		return iterator(_M_t._M_lower_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto lower_bound(const _Kt& __x) const -> decltype(const_iterator(_M_t._M_lower_bound_tr(__x)))
+	{
+		return const_iterator(_M_t._M_lower_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto upper_bound(const _Kt& __x) -> decltype(iterator(_M_t._M_upper_bound_tr(__x)))
+	{
+		return iterator(_M_t._M_upper_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto upper_bound(const _Kt& __x) const -> decltype(const_iterator(_M_t._M_upper_bound_tr(__x)))
+	{
+		return const_iterator(_M_t._M_upper_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto equal_range(const _Kt& __x) -> decltype(std::pair<iterator, iterator>(
+	        _M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x)))
+	{
+		return std::pair<iterator, iterator>(_M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x));
+	}
+
+	template<typename _Kt>
+	auto equal_range(const _Kt& __x) const -> decltype(std::pair<const_iterator, const_iterator>(
+	        _M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x)))
+	{
+		return std::pair<const_iterator, const_iterator>(_M_t._M_lower_bound_tr(__x), _M_t._M_upper_bound_tr(__x));
+	}
+	//@}
+#endif
+
+	// set algebra
+	/**
+	 *  @brief  Builds the union of this %linked_set and another one.
+	 *  @param  __x  A %linked_set of the same type.
+	 *  @return  A %linked_set holding every element present in either set.
+	 *
+	 *  Both sets are walked in key order and merged; the result is built by
+	 *  appending at its end, which takes amortized constant time per
+	 *  element.  The whole operation is linear in size() + __x.size().
+	 *  The insertion order of the result is ascending key order.
+	 */
+	linked_set set_union(const linked_set& __x) const
+	{
+		linked_set __r(key_comp(), get_allocator());
+		std::set_union(begin(), end(), __x.begin(), __x.end(), _Append_iterator(__r), key_comp());
+		return __r;
+	}
+
+	/**
+	 *  @brief  Builds the intersection of this %linked_set and another one.
+	 *  @param  __x  A %linked_set of the same type.
+	 *  @return  A %linked_set holding every element present in both sets.
+	 *
+	 *  Linear in size() + __x.size(); see set_union().
+	 */
+	linked_set set_intersection(const linked_set& __x) const
+	{
+		linked_set __r(key_comp(), get_allocator());
+		std::set_intersection(begin(), end(), __x.begin(), __x.end(), _Append_iterator(__r), key_comp());
+		return __r;
+	}
+
+	/**
+	 *  @brief  Builds the difference of this %linked_set and another one.
+	 *  @param  __x  A %linked_set of the same type.
+	 *  @return  A %linked_set holding the elements of *this that are not in
+	 *           @a __x.
+	 *
+	 *  Linear in size() + __x.size(); see set_union().
+	 */
+	linked_set set_difference(const linked_set& __x) const
+	{
+		linked_set __r(key_comp(), get_allocator());
+		std::set_difference(begin(), end(), __x.begin(), __x.end(), _Append_iterator(__r), key_comp());
+		return __r;
+	}
+
+	/**
+	 *  @brief  Builds the symmetric difference of this %linked_set and
+	 *          another one.
+	 *  @param  __x  A %linked_set of the same type.
+	 *  @return  A %linked_set holding the elements present in exactly one
+	 *           of the two sets.
+	 *
+	 *  Linear in size() + __x.size(); see set_union().
+	 */
+	linked_set set_symmetric_difference(const linked_set& __x) const
+	{
+		linked_set __r(key_comp(), get_allocator());
+		std::set_symmetric_difference(begin(), end(), __x.begin(), __x.end(), _Append_iterator(__r),
+										key_comp());
+		return __r;
+	}
+
 	template<typename _K1, typename _C1, typename _A1>
 	friend bool operator==(const linked_set<_K1, _C1, _A1>&, const linked_set<_K1, _C1, _A1>&);
 
@@ -935,6 +1330,38 @@ inline bool operator>=(const linked_set<_Key, _Compare, _Alloc>& __x,
 	return !(__x < __y);
 }
 
+/// See ant::linked_set::set_union().
+template<typename _Key, typename _Compare, typename _Alloc>
+inline linked_set<_Key, _Compare, _Alloc> set_union(const linked_set<_Key, _Compare, _Alloc>& __x,
+													const linked_set<_Key, _Compare, _Alloc>& __y)
+{
+	return __x.set_union(__y);
+}
+
+/// See ant::linked_set::set_intersection().
+template<typename _Key, typename _Compare, typename _Alloc>
+inline linked_set<_Key, _Compare, _Alloc> set_intersection(const linked_set<_Key, _Compare, _Alloc>& __x,
+															const linked_set<_Key, _Compare, _Alloc>& __y)
+{
+	return __x.set_intersection(__y);
+}
+
+/// See ant::linked_set::set_difference().
+template<typename _Key, typename _Compare, typename _Alloc>
+inline linked_set<_Key, _Compare, _Alloc> set_difference(const linked_set<_Key, _Compare, _Alloc>& __x,
+														const linked_set<_Key, _Compare, _Alloc>& __y)
+{
+	return __x.set_difference(__y);
+}
+
+/// See ant::linked_set::set_symmetric_difference().
+template<typename _Key, typename _Compare, typename _Alloc>
+inline linked_set<_Key, _Compare, _Alloc> set_symmetric_difference(const linked_set<_Key, _Compare, _Alloc>& __x,
+																	const linked_set<_Key, _Compare, _Alloc>& __y)
+{
+	return __x.set_symmetric_difference(__y);
+}
+
 /// See ant::linked_set::swap().
 template<typename _Key, typename _Compare, typename _Alloc>
 inline void swap(linked_set<_Key, _Compare, _Alloc>& __x,
@@ -943,6 +1370,16 @@ inline void swap(linked_set<_Key, _Compare, _Alloc>& __x,
 	__x.swap(__y);
 }
 
+#if __cplusplus >= 201703L
+namespace pmr {
+
+/// %linked_set allocating from a std::pmr::memory_resource.
+template<typename _Key, typename _Compare = std::less<_Key> >
+using linked_set = ant::linked_set<_Key, _Compare, std::pmr::polymorphic_allocator<_Key> >;
+
+} // namespace pmr
+#endif
+
 } // namespace ant
 
 #endif /* LIBANT_CONTAINER_LINKED_SET_H_ */
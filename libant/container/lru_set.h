@@ -21,12 +21,56 @@ public:
 		maxCachedKeys_ = maxCachedKeys;
 	}
 
+	/**
+	 * @param alloc allocator for the keys, e.g. a std::pmr::polymorphic_allocator
+	 */
+	lru_set(size_t maxCachedKeys, const _Alloc& alloc) : set_(alloc)
+	{
+		maxCachedKeys_ = maxCachedKeys;
+	}
+
 	/**
 	 * @return 返回true表示插入成功，false表示key已存在
 	 */
 	bool emplace(_Key&& key)
 	{
-		auto ret = set_.emplace(key);
+		return on_inserted(set_.emplace(std::move(key)));
+	}
+
+	/**
+	 * @return 返回true表示插入成功，false表示key已存在
+	 */
+	bool insert(const _Key& key)
+	{
+		return on_inserted(set_.insert(key));
+	}
+
+	size_type erase(const _Key& key)
+	{
+		return set_.erase(key);
+	}
+
+	/**
+	 * @return memory used by the cached keys, see linked_set::memory_usage()
+	 */
+	container_memory_usage memory_usage() const
+	{
+		return set_.memory_usage();
+	}
+
+	/**
+	 * @return bytes each cached key costs beyond sizeof(_Key)
+	 */
+	static size_type node_overhead()
+	{
+		return linked_set<_Key, _Compare, _Alloc>::node_overhead();
+	}
+
+private:
+	typedef typename linked_set<_Key, _Compare, _Alloc>::iterator iterator;
+
+	bool on_inserted(const std::pair<iterator, bool>& ret)
+	{
 		if (ret.second) { // 插入成功
 			if (set_.size() > maxCachedKeys_) {
 				// 缓存个数太多，删除最老不被使用的缓存
@@ -39,21 +83,20 @@ public:
 		return false;
 	}
 
-	bool insert(const _Key& key)
-	{
-		return emplace(std::string(key));
-	}
-
-	size_type erase(const _Key& key)
-	{
-		return set_.erase(key);
-	}
-
 private:
 	size_type							maxCachedKeys_;
 	linked_set<_Key, _Compare, _Alloc>	set_;
 };
 
+#if __cplusplus >= 201703L
+namespace pmr {
+
+template<typename _Key, typename _Compare = std::less<_Key> >
+using lru_set = ant::lru_set<_Key, _Compare, std::pmr::polymorphic_allocator<_Key> >;
+
+}
+#endif
+
 }
 
 #endif // LIBANT_CONTAINER_LRU_SET_H_
@@ -0,0 +1,158 @@
+#include <cmath>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+#include "lru_workload.h"
+
+namespace ant {
+
+namespace {
+
+double zeta(uint64_t n, double theta)
+{
+	double sum = 0;
+	for (uint64_t i = 1; i <= n; ++i) {
+		sum += 1 / std::pow(double(i), theta);
+	}
+	return sum;
+}
+
+}
+
+zipf_generator::zipf_generator(uint64_t n, double theta, uint64_t seed) :
+		rng_(seed), uniform_(0, 1), n_(n ? n : 1), theta_(theta), alpha_(1 / (1 - theta)),
+		zetan_(zeta(n_, theta)), eta_(0), halfPowTheta_(std::pow(0.5, theta))
+{
+	if (n_ > 2) {
+		eta_ = (1 - std::pow(2.0 / n_, 1 - theta_)) / (1 - zeta(2, theta_) / zetan_);
+	}
+}
+
+uint64_t zipf_generator::operator()()
+{
+	double u = uniform_(rng_);
+	double uz = u * zetan_;
+	if (uz < 1) {
+		return 0;
+	}
+	if (uz < 1 + halfPowTheta_) {
+		return 1;
+	}
+	uint64_t k = static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+	return k < n_ ? k : n_ - 1;
+}
+
+scan_mix_generator::scan_mix_generator(uint64_t n, double theta, double scanFraction, uint64_t scanLength,
+									   uint64_t seed) :
+		zipf_(n, theta, seed), rng_(seed ^ 0x9e3779b97f4a7c15ULL), uniform_(0, 1), n_(n ? n : 1),
+		scanLength_(scanLength ? scanLength : 1), scanLeft_(0), scanNext_(0)
+{
+	// with q the chance to start a scan, scans make up q*L / (q*L + 1 - q) of the stream
+	scanStart_ = scanFraction / (scanLength_ * (1 - scanFraction) + scanFraction);
+}
+
+uint64_t scan_mix_generator::operator()()
+{
+	if (scanLeft_ == 0 && uniform_(rng_) < scanStart_) {
+		scanLeft_ = scanLength_;
+		scanNext_ = rng_() % n_;
+	}
+	if (scanLeft_) {
+		--scanLeft_;
+		uint64_t k = scanNext_;
+		scanNext_ = (scanNext_ + 1 == n_) ? 0 : scanNext_ + 1;
+		return k;
+	}
+	return zipf_();
+}
+
+temporal_generator::temporal_generator(uint64_t n, uint64_t workingSet, uint64_t shiftEvery, uint64_t seed) :
+		rng_(seed), n_(n ? n : 1), workingSet_(workingSet ? workingSet : 1),
+		shiftEvery_(shiftEvery ? shiftEvery : 1), drawn_(0), offset_(0)
+{
+	if (workingSet_ > n_) {
+		workingSet_ = n_;
+	}
+}
+
+uint64_t temporal_generator::operator()()
+{
+	if (++drawn_ % shiftEvery_ == 0) {
+		offset_ = (offset_ + 1) % n_;
+	}
+	return (offset_ + rng_() % workingSet_) % n_;
+}
+
+std::vector<std::string> load_key_trace(const std::string& path)
+{
+	std::ifstream in(path.c_str());
+	if (!in) {
+		throw std::runtime_error("load_key_trace: can't open " + path);
+	}
+
+	std::vector<std::string> keys;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		keys.push_back(line);
+	}
+	if (in.bad()) {
+		throw std::runtime_error("load_key_trace: read error on " + path);
+	}
+	return keys;
+}
+
+latency_histogram::latency_histogram() : counts_(64 << sub_bucket_bits), total_(0)
+{
+}
+
+void latency_histogram::record(uint64_t ns)
+{
+	size_t idx;
+	if (ns < (1u << sub_bucket_bits)) {
+		idx = ns;
+	} else {
+		// the top sub_bucket_bits bits below the most significant one pick the sub bucket
+		int shift = 63 - __builtin_clzll(ns) - sub_bucket_bits;
+		idx = (size_t(shift + 1) << sub_bucket_bits) + ((ns >> shift) & ((1u << sub_bucket_bits) - 1));
+	}
+	++counts_[idx];
+	++total_;
+}
+
+uint64_t latency_histogram::percentile(double p) const
+{
+	if (total_ == 0) {
+		return 0;
+	}
+
+	uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100 * total_));
+	if (rank == 0) {
+		rank = 1;
+	}
+	uint64_t seen = 0;
+	for (size_t idx = 0; idx != counts_.size(); ++idx) {
+		seen += counts_[idx];
+		if (seen >= rank) {
+			if (idx < (1u << sub_bucket_bits)) {
+				return idx;
+			}
+			int shift = int(idx >> sub_bucket_bits) - 1;
+			uint64_t sub = idx & ((1u << sub_bucket_bits) - 1);
+			return (((uint64_t(1) << sub_bucket_bits) + sub + 1) << shift) - 1;
+		}
+	}
+	return UINT64_MAX;
+}
+
+std::ostream& operator<<(std::ostream& out, const workload_stats& stats)
+{
+	return out << "capacity=" << stats.capacity << " ops=" << stats.ops << " hit_ratio=" << stats.hit_ratio
+			   << " ops/s=" << static_cast<uint64_t>(stats.ops_per_sec) << " p50=" << stats.p50_ns << "ns"
+			   << " p99=" << stats.p99_ns << "ns peak_bytes=" << stats.peak_bytes;
+}
+
+}
@@ -0,0 +1,243 @@
+/**
+ * @file container/lru_workload.h
+ * @brief Synthetic and recorded key streams for sizing and comparing LRU caches.
+ *
+ * Generate a key stream, then replay it against a cache once per capacity:
+ *
+ *     ant::zipf_generator gen(1000000, 0.99);
+ *     std::vector<uint64_t> keys = ant::generate_keys(gen, 10000000);
+ *     std::vector<size_t> capacities = {10000, 100000, 1000000};
+ *     for (const ant::workload_stats& s : ant::replay_lru_set(keys, capacities)) {
+ *         std::cout << s << std::endl;
+ *     }
+ *
+ * Other caches are replayed with replay_workload() and two callables, one
+ * accessing a key and reporting whether it hit, one reporting the bytes the
+ * cache uses.
+ */
+
+#ifndef LIBANT_CONTAINER_LRU_WORKLOAD_H_
+#define LIBANT_CONTAINER_LRU_WORKLOAD_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lru_set.h"
+
+namespace ant {
+
+/**
+ * @brief Zipfian keys in [0, n), key k drawn with a probability proportional to 1 / (k + 1)^theta.
+ *
+ * Key 0 is the hottest. Uses the method of Gray et al., "Quickly Generating
+ * Billion-Record Synthetic Databases", as YCSB does: construction sums the
+ * zeta function in O(n), drawing a key takes constant time.
+ */
+class zipf_generator {
+public:
+	/**
+	 * @param n number of distinct keys, at least 1
+	 * @param theta skew in (0, 1); YCSB uses 0.99
+	 */
+	zipf_generator(uint64_t n, double theta = 0.99, uint64_t seed = 1);
+
+	uint64_t operator()();
+
+private:
+	std::mt19937_64	rng_;
+	std::uniform_real_distribution<double>	uniform_;
+	uint64_t		n_;
+	double			theta_;
+	double			alpha_;
+	double			zetan_;
+	double			eta_;
+	double			halfPowTheta_;
+};
+
+/**
+ * @brief Zipfian traffic interleaved with sequential scans, the pattern that flushes an LRU.
+ *
+ * A scan reads scanLength consecutive keys from a random start, wrapping
+ * around at n. Scans are started so that scanFraction of all keys drawn
+ * belong to scans.
+ */
+class scan_mix_generator {
+public:
+	/**
+	 * @param scanFraction share of the stream made of scans, in [0, 1)
+	 */
+	scan_mix_generator(uint64_t n, double theta, double scanFraction, uint64_t scanLength, uint64_t seed = 1);
+
+	uint64_t operator()();
+
+private:
+	zipf_generator	zipf_;
+	std::mt19937_64	rng_;
+	std::uniform_real_distribution<double>	uniform_;
+	uint64_t		n_;
+	uint64_t		scanLength_;
+	double			scanStart_;		// probability that a key starts a scan
+	uint64_t		scanLeft_;
+	uint64_t		scanNext_;
+};
+
+/**
+ * @brief Keys drawn uniformly from a working set that drifts through [0, n).
+ *
+ * The working set is the window of workingSet keys starting at an offset
+ * that moves one key forward every shiftEvery keys drawn, so recently used
+ * keys are likely to be used again and old ones fade out.
+ */
+class temporal_generator {
+public:
+	temporal_generator(uint64_t n, uint64_t workingSet, uint64_t shiftEvery, uint64_t seed = 1);
+
+	uint64_t operator()();
+
+private:
+	std::mt19937_64	rng_;
+	uint64_t		n_;
+	uint64_t		workingSet_;
+	uint64_t		shiftEvery_;
+	uint64_t		drawn_;
+	uint64_t		offset_;
+};
+
+/**
+ * @return count keys drawn from gen
+ */
+template<typename _Generator>
+std::vector<uint64_t> generate_keys(_Generator& gen, size_t count)
+{
+	std::vector<uint64_t> keys;
+	keys.reserve(count);
+	for (size_t i = 0; i != count; ++i) {
+		keys.push_back(gen());
+	}
+	return keys;
+}
+
+/**
+ * @brief Reads a recorded key trace, one key per line.
+ * @throw std::runtime_error if the file can't be read
+ */
+std::vector<std::string> load_key_trace(const std::string& path);
+
+/**
+ * @brief Per-operation latency histogram with about 6% resolution.
+ */
+class latency_histogram {
+public:
+	latency_histogram();
+
+	void record(uint64_t ns);
+
+	/**
+	 * @param p percentile in [0, 100]
+	 * @return upper bound of the bucket holding the percentile, 0 if nothing was recorded
+	 */
+	uint64_t percentile(double p) const;
+
+private:
+	static const int sub_bucket_bits = 4;
+
+	std::vector<uint64_t>	counts_;
+	uint64_t				total_;
+};
+
+/**
+ * @brief Outcome of replaying a key stream against a cache.
+ */
+struct workload_stats {
+	size_t		capacity;
+	uint64_t	ops;
+	uint64_t	hits;
+	double		hit_ratio;
+	double		ops_per_sec;
+	uint64_t	p50_ns;
+	uint64_t	p99_ns;
+	/// Largest of the memory samples taken during the replay.
+	size_t		peak_bytes;
+};
+
+std::ostream& operator<<(std::ostream& out, const workload_stats& stats);
+
+/**
+ * @brief Replays keys against a cache.
+ * @param access called as access(key) for every key, returns true on a hit
+ * @param memory called as memory() to sample the bytes used by the cache
+ *
+ * Every 16th access is timed for the latency percentiles, so timing adds
+ * little to the throughput figure. Memory is sampled 64 times over the
+ * replay and at its end.
+ */
+template<typename _Key, typename _Access, typename _Memory>
+workload_stats replay_workload(const std::vector<_Key>& keys, _Access access, _Memory memory)
+{
+	typedef std::chrono::steady_clock clock;
+	const size_t latencyEvery = 16;
+	const size_t memoryEvery = keys.size() / 64 + 1;
+
+	workload_stats stats = workload_stats();
+	latency_histogram latency;
+	size_t nextMemory = memoryEvery;
+	clock::time_point start = clock::now();
+	for (size_t i = 0; i != keys.size(); ++i) {
+		bool hit;
+		if (i % latencyEvery == 0) {
+			clock::time_point t = clock::now();
+			hit = access(keys[i]);
+			latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t).count());
+		} else {
+			hit = access(keys[i]);
+		}
+		stats.hits += hit;
+		if (i == nextMemory) {
+			clock::time_point t = clock::now();
+			size_t bytes = memory();
+			if (bytes > stats.peak_bytes) {
+				stats.peak_bytes = bytes;
+			}
+			nextMemory += memoryEvery;
+			start += clock::now() - t; // sampling memory is not part of the workload
+		}
+	}
+	double secs = std::chrono::duration<double>(clock::now() - start).count();
+
+	size_t bytes = memory();
+	if (bytes > stats.peak_bytes) {
+		stats.peak_bytes = bytes;
+	}
+	stats.ops = keys.size();
+	stats.hit_ratio = stats.ops ? double(stats.hits) / stats.ops : 0;
+	stats.ops_per_sec = secs > 0 ? stats.ops / secs : 0;
+	stats.p50_ns = latency.percentile(50);
+	stats.p99_ns = latency.percentile(99);
+	return stats;
+}
+
+/**
+ * @brief Replays keys against a fresh lru_set of every capacity given.
+ */
+template<typename _Key>
+std::vector<workload_stats> replay_lru_set(const std::vector<_Key>& keys, const std::vector<size_t>& capacities)
+{
+	std::vector<workload_stats> result;
+	for (size_t i = 0; i != capacities.size(); ++i) {
+		lru_set<_Key> cache(capacities[i]);
+		workload_stats stats = replay_workload(keys,
+			[&cache](const _Key& key) { return !cache.insert(key); },
+			[&cache]() { return cache.memory_usage().total_bytes(); });
+		stats.capacity = capacities[i];
+		result.push_back(stats);
+	}
+	return result;
+}
+
+}
+
+#endif // LIBANT_CONTAINER_LRU_WORKLOAD_H_
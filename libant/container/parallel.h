@@ -0,0 +1,229 @@
+/**
+ * @file container/parallel.h
+ * @brief Parallel algorithms over linked_map and linked_set.
+ *
+ * The algorithms mirror the std::execution overloads of their std
+ * counterparts but take a whole container:
+ *
+ *     size_t n = ant::count_if(ant::execution::par, m, pred);
+ *     double sum = ant::transform_reduce(ant::execution::par(8), m, 0.0, std::plus<double>(), value_of);
+ *
+ * A parallel run cuts the key range into subtrees with split(), several per
+ * thread, and the threads take ranges one by one until none is left, so a
+ * thread that got a large subtree doesn't hold the others up. Callables are
+ * shared by all threads and must be safe to call concurrently. The
+ * container must not be modified while an algorithm runs. If a call throws,
+ * the remaining ranges are skipped and the first exception is rethrown.
+ */
+
+#ifndef LIBANT_CONTAINER_PARALLEL_H_
+#define LIBANT_CONTAINER_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ant {
+
+namespace execution {
+
+/**
+ * @brief Runs an algorithm on the calling thread.
+ */
+struct sequenced_policy {
+};
+
+/**
+ * @brief Runs an algorithm on several threads.
+ */
+struct parallel_policy {
+	constexpr parallel_policy() : threads_(0)
+	{
+	}
+
+	constexpr explicit parallel_policy(unsigned threads) : threads_(threads)
+	{
+	}
+
+	/**
+	 * @return a policy running on the given number of threads, 0 meaning one per hardware thread
+	 */
+	constexpr parallel_policy operator()(unsigned threads) const
+	{
+		return parallel_policy(threads);
+	}
+
+	unsigned	threads_;
+};
+
+constexpr sequenced_policy seq{};
+constexpr parallel_policy par{};
+
+}
+
+template<typename _Tp>
+struct is_execution_policy : std::false_type {
+};
+
+template<>
+struct is_execution_policy<execution::sequenced_policy> : std::true_type {
+};
+
+template<>
+struct is_execution_policy<execution::parallel_policy> : std::true_type {
+};
+
+template<typename _Policy, typename _Ret>
+struct _Enable_if_execution_policy
+		: std::enable_if<is_execution_policy<typename std::decay<_Policy>::type>::value, _Ret> {
+};
+
+// Ranges per thread; more of them evens out subtrees of unequal size.
+const unsigned _Parallel_ranges_per_thread = 4;
+
+inline unsigned _Parallel_threads(const execution::parallel_policy& __policy)
+{
+	unsigned __n = __policy.threads_ ? __policy.threads_ : std::thread::hardware_concurrency();
+	return __n ? __n : 1;
+}
+
+// Calls __body(__i, __b[__i], __b[__i + 1]) for every range on up to
+// __threads threads, the calling one included.
+template<typename _Iterator, typename _Body>
+void _Parallel_run(const std::vector<_Iterator>& __b, unsigned __threads, const _Body& __body)
+{
+	const size_t __ranges = __b.size() - 1;
+	std::atomic<size_t> __next(0);
+	std::atomic<bool> __failed(false);
+	std::exception_ptr __error;
+	std::mutex __mtx;
+
+	auto __worker = [&]() {
+		for (;;) {
+			size_t __i = __next.fetch_add(1, std::memory_order_relaxed);
+			if (__i >= __ranges || __failed.load(std::memory_order_relaxed)) {
+				return;
+			}
+			try {
+				__body(__i, __b[__i], __b[__i + 1]);
+			} catch (...) {
+				std::lock_guard<std::mutex> __lock(__mtx);
+				if (!__error) {
+					__error = std::current_exception();
+				}
+				__failed.store(true, std::memory_order_relaxed);
+				return;
+			}
+		}
+	};
+
+	std::vector<std::thread> __pool;
+	unsigned __extra = static_cast<unsigned>(std::min<size_t>(__threads, __ranges));
+	if (__extra) {
+		--__extra;
+	}
+	__pool.reserve(__extra);
+	for (unsigned __t = 0; __t != __extra; ++__t) {
+		try {
+			__pool.push_back(std::thread(__worker));
+		} catch (...) {
+			// out of threads, the ones running will cover the rest
+			break;
+		}
+	}
+	__worker();
+	for (size_t __t = 0; __t != __pool.size(); ++__t) {
+		__pool[__t].join();
+	}
+
+	if (__error) {
+		std::rethrow_exception(__error);
+	}
+}
+
+/**
+ * @brief Calls fn on every element of c, in key order for execution::seq.
+ */
+template<typename _Container, typename _Fn>
+void for_each(const execution::sequenced_policy&, _Container& c, _Fn fn)
+{
+	std::for_each(c.begin(), c.end(), fn);
+}
+
+template<typename _Container, typename _Fn>
+void for_each(const execution::parallel_policy& policy, _Container& c, _Fn fn)
+{
+	typedef decltype(c.begin()) iterator;
+	unsigned threads = _Parallel_threads(policy);
+	std::vector<iterator> b = c.split(threads * _Parallel_ranges_per_thread);
+	_Parallel_run(b, threads, [&fn](size_t, iterator first, iterator last) {
+		for (; first != last; ++first) {
+			fn(*first);
+		}
+	});
+}
+
+/**
+ * @brief Folds transform(element) of every element of c into init with reduce.
+ *
+ * reduce must be associative and commutative, as elements are combined in
+ * an unspecified order when run in parallel.
+ */
+template<typename _Container, typename _Tp, typename _Reduce, typename _Transform>
+_Tp transform_reduce(const execution::sequenced_policy&, const _Container& c, _Tp init,
+					 _Reduce reduce, _Transform transform)
+{
+	for (auto it = c.begin(); it != c.end(); ++it) {
+		init = reduce(std::move(init), transform(*it));
+	}
+	return init;
+}
+
+template<typename _Container, typename _Tp, typename _Reduce, typename _Transform>
+_Tp transform_reduce(const execution::parallel_policy& policy, const _Container& c, _Tp init,
+					 _Reduce reduce, _Transform transform)
+{
+	typedef decltype(c.begin()) iterator;
+	unsigned threads = _Parallel_threads(policy);
+	std::vector<iterator> b = c.split(threads * _Parallel_ranges_per_thread);
+	// split() never yields an empty range unless c is empty
+	std::vector<std::unique_ptr<_Tp> > partial(b.size() - 1);
+	_Parallel_run(b, threads, [&](size_t i, iterator first, iterator last) {
+		if (first == last) {
+			return;
+		}
+		_Tp acc = transform(*first);
+		for (++first; first != last; ++first) {
+			acc = reduce(std::move(acc), transform(*first));
+		}
+		partial[i].reset(new _Tp(std::move(acc)));
+	});
+	for (size_t i = 0; i != partial.size(); ++i) {
+		if (partial[i]) {
+			init = reduce(std::move(init), std::move(*partial[i]));
+		}
+	}
+	return init;
+}
+
+/**
+ * @return the number of elements of c satisfying pred
+ */
+template<typename _Policy, typename _Container, typename _Pred>
+typename _Enable_if_execution_policy<_Policy, size_t>::type
+count_if(_Policy&& policy, const _Container& c, _Pred pred)
+{
+	typedef decltype(*c.begin()) reference;
+	return transform_reduce(policy, c, size_t(0), [](size_t a, size_t b) { return a + b; },
+			[&pred](reference v) -> size_t { return pred(v) ? 1 : 0; });
+}
+
+}
+
+#endif // LIBANT_CONTAINER_PARALLEL_H_
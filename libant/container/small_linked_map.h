@@ -0,0 +1,727 @@
+/**
+ * @file container/small_linked_map.h
+ * @brief linked_map with inline storage for a few elements.
+ */
+
+#ifndef LIBANT_CONTAINER_SMALL_LINKED_MAP_H_
+#define LIBANT_CONTAINER_SMALL_LINKED_MAP_H_
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "linked_map.h"
+
+namespace ant {
+
+/**
+ * @brief A map that remembers insertion order and keeps up to _N elements inline.
+ *
+ * While it holds at most _N elements, a small_linked_map stores them in an
+ * array inside the object and finds keys by linear search, so a tiny map costs
+ * no heap allocation at all. Inserting the (_N + 1)th element moves everything
+ * into a linked_map, which is used from then on until clear().
+ *
+ * Only link order (insertion order) iteration is provided. Link iterators,
+ * pointers and references to elements stay valid across insertions and
+ * erasures of other elements, except that moving to the linked_map
+ * invalidates all of them. Inline elements never move between slots:
+ * link iterators name a slot, and erasing only rewrites the link order.
+ */
+template<typename _Key, typename _Tp, size_t _N = 8, typename _Compare = std::less<_Key>,
+			typename _Alloc = std::allocator<std::pair<const _Key, _Tp> > >
+class small_linked_map {
+	static_assert(_N > 0 && _N <= 255, "small_linked_map: inline capacity must be within [1, 255]");
+
+public:
+	typedef linked_map<_Key, _Tp, _Compare, _Alloc> map_type;
+	typedef _Key key_type;
+	typedef _Tp mapped_type;
+	typedef std::pair<const _Key, _Tp> value_type;
+	typedef _Compare key_compare;
+	typedef _Alloc allocator_type;
+	typedef typename map_type::size_type size_type;
+
+private:
+	template<bool _Const>
+	class link_iter {
+		typedef typename std::conditional<_Const, const small_linked_map, small_linked_map>::type owner_type;
+		typedef typename std::conditional<_Const, typename map_type::const_link_iterator,
+											typename map_type::link_iterator>::type tree_iterator;
+
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef typename small_linked_map::value_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef typename std::conditional<_Const, const value_type*, value_type*>::type pointer;
+		typedef typename std::conditional<_Const, const value_type&, value_type&>::type reference;
+
+	public:
+		link_iter() : owner_(0), slot_(_N)
+		{
+		}
+
+		// link_iterator to const_link_iterator
+		template<bool _C, typename = typename std::enable_if<_Const && !_C>::type>
+		link_iter(const link_iter<_C>& rhs) : owner_(rhs.owner_), slot_(rhs.slot_), it_(rhs.it_)
+		{
+		}
+
+		reference operator*() const
+		{
+			return owner_->spilled_ ? *it_ : owner_->slot(slot_);
+		}
+
+		pointer operator->() const
+		{
+			return std::__addressof(**this);
+		}
+
+		link_iter& operator++()
+		{
+			if (owner_->spilled_) {
+				++it_;
+			} else {
+				slot_ = owner_->slot_at(owner_->rank_[slot_] + 1);
+			}
+			return *this;
+		}
+
+		link_iter operator++(int)
+		{
+			link_iter tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		link_iter& operator--()
+		{
+			if (owner_->spilled_) {
+				--it_;
+			} else {
+				slot_ = owner_->order_[(slot_ == _N ? owner_->size_ : owner_->rank_[slot_]) - 1];
+			}
+			return *this;
+		}
+
+		link_iter operator--(int)
+		{
+			link_iter tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		template<bool _C>
+		bool operator==(const link_iter<_C>& rhs) const
+		{
+			return slot_ == rhs.slot_ && it_._M_node == rhs.it_._M_node;
+		}
+
+		template<bool _C>
+		bool operator!=(const link_iter<_C>& rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		link_iter(owner_type* owner, size_type slot) : owner_(owner), slot_(slot)
+		{
+		}
+
+		link_iter(owner_type* owner, tree_iterator it) : owner_(owner), slot_(0), it_(it)
+		{
+		}
+
+		friend class small_linked_map;
+		template<bool> friend class link_iter;
+
+	private:
+		owner_type*		owner_;
+		size_type		slot_;	// slot of the element while inline, _N for the end; 0 once spilled
+		tree_iterator	it_;	// used once spilled to the linked_map
+	};
+
+public:
+	typedef link_iter<false> link_iterator;
+	typedef link_iter<true> const_link_iterator;
+
+	static const size_type inline_capacity = _N;
+
+public:
+	small_linked_map() : size_(0), spilled_(false)
+	{
+		init_order();
+	}
+
+	explicit small_linked_map(const key_compare& comp, const allocator_type& alloc = allocator_type())
+		: size_(0), spilled_(false), comp_(comp), alloc_(alloc)
+	{
+		init_order();
+	}
+
+	small_linked_map(std::initializer_list<value_type> l, const key_compare& comp = key_compare(),
+						const allocator_type& alloc = allocator_type())
+		: size_(0), spilled_(false), comp_(comp), alloc_(alloc)
+	{
+		init_order();
+		try {
+			for (auto& v : l) {
+				insert(v);
+			}
+		} catch (...) {
+			destroy();
+			throw;
+		}
+	}
+
+	small_linked_map(const small_linked_map& rhs)
+		: small_linked_map(rhs, alloc_traits::select_on_container_copy_construction(rhs.alloc_))
+	{
+	}
+
+	small_linked_map(const small_linked_map& rhs, const allocator_type& alloc)
+		: size_(0), spilled_(false), comp_(rhs.comp_), alloc_(alloc)
+	{
+		init_order();
+		if (rhs.spilled_) {
+			::new (static_cast<void*>(&storage_)) map_type(rhs.map(), alloc);
+			spilled_ = true;
+			return;
+		}
+		try {
+			for (; size_ != rhs.size_; ++size_) {
+				::new (static_cast<void*>(slot_ptr(size_))) value_type(rhs.slot(rhs.order_[size_]));
+			}
+		} catch (...) {
+			destroy();
+			throw;
+		}
+	}
+
+	small_linked_map(small_linked_map&& rhs)
+		noexcept(std::is_nothrow_move_constructible<value_type>::value
+					&& std::is_nothrow_copy_constructible<key_compare>::value)
+		: size_(0), spilled_(false), comp_(rhs.comp_), alloc_(rhs.alloc_)
+	{
+		init_order();
+		steal(rhs);
+	}
+
+	~small_linked_map()
+	{
+		destroy();
+	}
+
+	/**
+	 * @brief Copies rhs. The allocator is copied too if the allocator propagates on copy assignment.
+	 */
+	small_linked_map& operator=(const small_linked_map& rhs)
+	{
+		if (&rhs != this) {
+			small_linked_map tmp(rhs, alloc_traits::propagate_on_container_copy_assignment::value ? rhs.alloc_ : alloc_);
+			clear();
+			steal(tmp);
+			comp_ = rhs.comp_;
+			assign_alloc(rhs.alloc_, typename alloc_traits::propagate_on_container_copy_assignment());
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Takes over the elements of rhs, or moves them one by one if the
+	 * allocators differ and the allocator does not propagate on move assignment.
+	 */
+	small_linked_map& operator=(small_linked_map&& rhs)
+	{
+		if (&rhs != this) {
+			if (alloc_traits::propagate_on_container_move_assignment::value || alloc_ == rhs.alloc_) {
+				clear();
+				steal(rhs);
+				assign_alloc(rhs.alloc_, typename alloc_traits::propagate_on_container_move_assignment());
+			} else {
+				small_linked_map tmp(rhs.comp_, alloc_);
+				for (link_iterator it = rhs.link_begin(); it != rhs.link_end(); ++it) {
+					tmp.emplace(std::move(*it));
+				}
+				clear();
+				steal(tmp);
+				rhs.clear();
+			}
+			comp_ = rhs.comp_;
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Swaps the elements, and the allocators if the allocator propagates on swap.
+	 * Elements are moved one by one if the allocators differ and don't propagate.
+	 */
+	void swap(small_linked_map& rhs)
+	{
+		if (alloc_traits::propagate_on_container_swap::value || alloc_ == rhs.alloc_) {
+			small_linked_map tmp(std::move(rhs));
+			rhs.clear();
+			rhs.steal(*this);
+			clear();
+			steal(tmp);
+			swap_alloc(rhs, typename alloc_traits::propagate_on_container_swap());
+		} else {
+			small_linked_map mine(rhs.comp_, alloc_);
+			for (link_iterator it = rhs.link_begin(); it != rhs.link_end(); ++it) {
+				mine.emplace(std::move(*it));
+			}
+			small_linked_map theirs(comp_, rhs.alloc_);
+			for (link_iterator it = link_begin(); it != link_end(); ++it) {
+				theirs.emplace(std::move(*it));
+			}
+			clear();
+			steal(mine);
+			rhs.clear();
+			rhs.steal(theirs);
+		}
+		std::swap(comp_, rhs.comp_);
+	}
+
+	key_compare key_comp() const
+	{
+		return comp_;
+	}
+
+	allocator_type get_allocator() const
+	{
+		return alloc_;
+	}
+
+	/**
+	 * @return true while the elements are still kept inline
+	 */
+	bool is_inline() const
+	{
+		return !spilled_;
+	}
+
+	size_type size() const
+	{
+		return spilled_ ? map().size() : size_;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	// link order iteration
+
+	link_iterator link_begin()
+	{
+		return spilled_ ? link_iterator(this, map().link_begin()) : link_iterator(this, slot_at(0));
+	}
+
+	link_iterator link_end()
+	{
+		return spilled_ ? link_iterator(this, map().link_end()) : link_iterator(this, size_type(_N));
+	}
+
+	const_link_iterator link_begin() const
+	{
+		return spilled_ ? const_link_iterator(this, map().link_begin()) : const_link_iterator(this, slot_at(0));
+	}
+
+	const_link_iterator link_end() const
+	{
+		return spilled_ ? const_link_iterator(this, map().link_end()) : const_link_iterator(this, size_type(_N));
+	}
+
+	const_link_iterator link_cbegin() const
+	{
+		return link_begin();
+	}
+
+	const_link_iterator link_cend() const
+	{
+		return link_end();
+	}
+
+	// lookup
+
+	link_iterator find(const key_type& key)
+	{
+		if (spilled_) {
+			return to_link(map().find(key), map().end());
+		}
+		return link_iterator(this, slot_at(find_pos(key)));
+	}
+
+	const_link_iterator find(const key_type& key) const
+	{
+		if (spilled_) {
+			return to_link(map().find(key), map().end());
+		}
+		return const_link_iterator(this, slot_at(find_pos(key)));
+	}
+
+	size_type count(const key_type& key) const
+	{
+		return spilled_ ? map().count(key) : size_type(find_pos(key) != size_);
+	}
+
+	mapped_type& at(const key_type& key)
+	{
+		link_iterator it = find(key);
+		if (it == link_end()) {
+			throw std::out_of_range("small_linked_map::at");
+		}
+		return it->second;
+	}
+
+	const mapped_type& at(const key_type& key) const
+	{
+		const_link_iterator it = find(key);
+		if (it == link_end()) {
+			throw std::out_of_range("small_linked_map::at");
+		}
+		return it->second;
+	}
+
+	mapped_type& operator[](const key_type& key)
+	{
+		return emplace_key(key)->second;
+	}
+
+	mapped_type& operator[](key_type&& key)
+	{
+		return emplace_key(std::move(key))->second;
+	}
+
+	// modifiers
+
+	/**
+	 * @brief Constructs value_type(args...) and appends it unless its key is already present.
+	 * @return iterator to the element with the key, and true if it was inserted
+	 */
+	template<typename... _Args>
+	std::pair<link_iterator, bool> emplace(_Args&&... args)
+	{
+		if (spilled_) {
+			auto ret = map().emplace(std::forward<_Args>(args)...);
+			return std::make_pair(to_link(ret.first, map().end()), ret.second);
+		}
+
+		if (size_ != _N) {
+			// build the element in the next free slot, so that no temporary is needed
+			value_type* v = slot_ptr(size_);
+			::new (static_cast<void*>(v)) value_type(std::forward<_Args>(args)...);
+			size_type pos = find_pos(v->first);
+			if (pos != size_) {
+				v->~value_type();
+				return std::make_pair(link_iterator(this, slot_at(pos)), false);
+			}
+			rank_[order_[pos]] = static_cast<uint8_t>(pos);
+			++size_;
+			return std::make_pair(link_iterator(this, slot_at(pos)), true);
+		}
+
+		value_type v(std::forward<_Args>(args)...);
+		size_type pos = find_pos(v.first);
+		if (pos != size_) {
+			return std::make_pair(link_iterator(this, slot_at(pos)), false);
+		}
+		spill();
+		auto ret = map().insert(std::move(v));
+		return std::make_pair(to_link(ret.first, map().end()), true);
+	}
+
+	std::pair<link_iterator, bool> insert(const value_type& value)
+	{
+		return emplace(value);
+	}
+
+	std::pair<link_iterator, bool> insert(value_type&& value)
+	{
+		return emplace(std::move(value));
+	}
+
+	/**
+	 * @return number of elements erased
+	 */
+	size_type erase(const key_type& key)
+	{
+		if (spilled_) {
+			return map().erase(key);
+		}
+		size_type pos = find_pos(key);
+		if (pos == size_) {
+			return 0;
+		}
+		erase_pos(pos);
+		return 1;
+	}
+
+	/**
+	 * @return iterator to the element inserted after the erased one
+	 */
+	link_iterator erase(const_link_iterator it)
+	{
+		if (spilled_) {
+			return link_iterator(this, map().erase(it.it_));
+		}
+		size_type pos = rank_[it.slot_];
+		erase_pos(pos);
+		return link_iterator(this, slot_at(pos));
+	}
+
+	/**
+	 * @brief Erases all the elements and goes back to inline storage.
+	 */
+	void clear()
+	{
+		destroy();
+		size_ = 0;
+		spilled_ = false;
+		init_order();
+	}
+
+private:
+	typedef std::allocator_traits<allocator_type> alloc_traits;
+
+	// Whether keys can be compared with == instead of two calls of comp_.
+	typedef std::integral_constant<bool, (std::is_integral<_Key>::value || std::is_enum<_Key>::value
+											|| std::is_pointer<_Key>::value)
+											&& std::is_same<_Compare, std::less<_Key> >::value> scalar_key;
+
+	value_type* slot_ptr(size_type pos)
+	{
+		return reinterpret_cast<value_type*>(&storage_) + order_[pos];
+	}
+
+	value_type& slot(size_type idx)
+	{
+		return reinterpret_cast<value_type*>(&storage_)[idx];
+	}
+
+	const value_type& slot(size_type idx) const
+	{
+		return reinterpret_cast<const value_type*>(&storage_)[idx];
+	}
+
+	map_type& map()
+	{
+		return *reinterpret_cast<map_type*>(&storage_);
+	}
+
+	const map_type& map() const
+	{
+		return *reinterpret_cast<const map_type*>(&storage_);
+	}
+
+	void init_order()
+	{
+		for (size_type i = 0; i != _N; ++i) {
+			order_[i] = static_cast<uint8_t>(i);
+			rank_[i] = static_cast<uint8_t>(i);
+		}
+	}
+
+	/**
+	 * @return slot of the element at position pos in link order, or _N if pos is size_
+	 */
+	size_type slot_at(size_type pos) const
+	{
+		return pos == size_ ? _N : order_[pos];
+	}
+
+	/**
+	 * @return position of key in link order, or size_ if absent
+	 */
+	size_type find_pos(const key_type& key) const
+	{
+		return find_pos(key, scalar_key());
+	}
+
+	// Scalar keys: visit every element and select the match without branching,
+	// so that the loop is a fixed sequence of compares and conditional moves.
+	size_type find_pos(const key_type& key, std::true_type) const
+	{
+		size_type pos = size_;
+		for (size_type i = size_; i-- != 0; ) {
+			pos = (slot(order_[i]).first == key) ? i : pos;
+		}
+		return pos;
+	}
+
+	size_type find_pos(const key_type& key, std::false_type) const
+	{
+		for (size_type i = 0; i != size_; ++i) {
+			const key_type& k = slot(order_[i]).first;
+			if (!comp_(k, key) && !comp_(key, k)) {
+				return i;
+			}
+		}
+		return size_;
+	}
+
+	// Only the order_ bytes move; the elements themselves stay in their slots,
+	// so iterators to the other elements remain valid.
+	void erase_pos(size_type pos)
+	{
+		uint8_t idx = order_[pos];
+		slot(idx).~value_type();
+		memmove(order_ + pos, order_ + pos + 1, size_ - pos - 1);
+		order_[--size_] = idx;
+		for (; pos != size_; ++pos) {
+			rank_[order_[pos]] = static_cast<uint8_t>(pos);
+		}
+	}
+
+	void assign_alloc(const allocator_type& alloc, std::true_type)
+	{
+		alloc_ = alloc;
+	}
+
+	void assign_alloc(const allocator_type&, std::false_type)
+	{
+	}
+
+	void swap_alloc(small_linked_map& rhs, std::true_type)
+	{
+		using std::swap;
+		swap(alloc_, rhs.alloc_);
+	}
+
+	void swap_alloc(small_linked_map&, std::false_type)
+	{
+	}
+
+	template<typename _K>
+	link_iterator emplace_key(_K&& key)
+	{
+		link_iterator it = find(key);
+		if (it == link_end()) {
+			it = emplace(std::piecewise_construct, std::forward_as_tuple(std::forward<_K>(key)), std::tuple<>()).first;
+		}
+		return it;
+	}
+
+	link_iterator to_link(typename map_type::iterator it, typename map_type::iterator end)
+	{
+		if (it == end) {
+			return link_iterator(this, map().link_end());
+		}
+		typedef typename map_type::link_iterator tree_link_iterator;
+		return link_iterator(this, tree_link_iterator(static_cast<typename tree_link_iterator::_Link_type>(it._M_node)));
+	}
+
+	const_link_iterator to_link(typename map_type::const_iterator it, typename map_type::const_iterator end) const
+	{
+		if (it == end) {
+			return const_link_iterator(this, map().link_end());
+		}
+		typedef typename map_type::const_link_iterator tree_link_iterator;
+		return const_link_iterator(this, tree_link_iterator(static_cast<typename tree_link_iterator::_Link_type>(it._M_node)));
+	}
+
+	/**
+	 * @brief Moves the inline elements into a linked_map. Leaves *this untouched if that throws.
+	 *
+	 * Elements whose move can throw are copied, so they are still in place;
+	 * nothrow-movable ones are moved back into their slots. Only elements
+	 * that can neither be copied nor moved without throwing are left as
+	 * the failed move made them.
+	 */
+	void spill()
+	{
+		map_type m(comp_, alloc_);
+		try {
+			for (size_type i = 0; i != size_; ++i) {
+				m.insert(m.end(), std::move_if_noexcept(slot(order_[i])));
+			}
+		} catch (...) {
+			if (std::is_nothrow_move_constructible<value_type>::value) {
+				size_type i = 0;
+				for (typename map_type::link_iterator it = m.link_begin(); it != m.link_end(); ++it, ++i) {
+					value_type* v = slot_ptr(i);
+					v->~value_type();
+					::new (static_cast<void*>(v)) value_type(std::move(*it));
+				}
+			}
+			throw;
+		}
+		destroy();
+		::new (static_cast<void*>(&storage_)) map_type(std::move(m));
+		spilled_ = true;
+	}
+
+	/**
+	 * @brief Destroys the elements or the linked_map. Leaves size_, spilled_ and order_ as they are.
+	 */
+	void destroy()
+	{
+		if (spilled_) {
+			map().~map_type();
+		} else {
+			for (size_type i = 0; i != size_; ++i) {
+				slot(order_[i]).~value_type();
+			}
+		}
+	}
+
+	/**
+	 * @brief Takes over the elements of rhs, which must be empty afterwards. *this must be empty and inline.
+	 *
+	 * If moving an element throws, *this is left empty and rhs is not cleared.
+	 */
+	void steal(small_linked_map& rhs)
+	{
+		if (rhs.spilled_) {
+			::new (static_cast<void*>(&storage_)) map_type(std::move(rhs.map()));
+			spilled_ = true;
+		} else {
+			// elements are moved in link order, so a move also compacts order_
+			try {
+				for (; size_ != rhs.size_; ++size_) {
+					::new (static_cast<void*>(slot_ptr(size_))) value_type(std::move(rhs.slot(rhs.order_[size_])));
+				}
+			} catch (...) {
+				destroy();
+				size_ = 0;
+				throw;
+			}
+		}
+		rhs.clear();
+	}
+
+private:
+	static const size_t storage_size = sizeof(value_type) * _N > sizeof(map_type)
+										? sizeof(value_type) * _N : sizeof(map_type);
+	static const size_t storage_align = alignof(value_type) > alignof(map_type)
+										? alignof(value_type) : alignof(map_type);
+
+	typename std::aligned_storage<storage_size, storage_align>::type storage_; // value_type[_N] or map_type
+	uint8_t			order_[_N];	// slot indexes in link order; slots past size_ are free
+	uint8_t			rank_[_N];	// position in order_ of each occupied slot
+	uint8_t			size_;		// element count while inline
+	bool			spilled_;
+	key_compare		comp_;
+	allocator_type	alloc_;
+};
+
+template<typename _Key, typename _Tp, size_t _N, typename _Compare, typename _Alloc>
+const typename small_linked_map<_Key, _Tp, _N, _Compare, _Alloc>::size_type
+	small_linked_map<_Key, _Tp, _N, _Compare, _Alloc>::inline_capacity;
+
+template<typename _Key, typename _Tp, size_t _N, typename _Compare, typename _Alloc>
+inline void swap(small_linked_map<_Key, _Tp, _N, _Compare, _Alloc>& x,
+					small_linked_map<_Key, _Tp, _N, _Compare, _Alloc>& y)
+{
+	x.swap(y);
+}
+
+}
+
+#endif // LIBANT_CONTAINER_SMALL_LINKED_MAP_H_
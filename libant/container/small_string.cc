@@ -1,7 +1,57 @@
-﻿#include "small_string.h"
+﻿#include <new>
+
+#include "small_string.h"
 
 namespace ant {
 
+small_string_arena::small_string_arena(size_t chunkSize) :
+		chunks_(0), cur_(0), end_(0), chunkSize_(chunkSize), chunkCount_(0), reserved_(0), used_(0)
+{
+}
+
+void* small_string_arena::allocate_slow(size_t bytes, size_t align)
+{
+	const size_t header = (sizeof(chunk) + 15) & ~size_t(15);
+	// a big buffer gets a chunk of its own and the current one stays open
+	const bool own = bytes > chunkSize_ / 4;
+	const size_t size = header + (own ? bytes : chunkSize_);
+
+	chunk* c = static_cast<chunk*>(::operator new(size));
+	c->size_ = size;
+	if (own && chunks_) {
+		c->next_ = chunks_->next_;
+		chunks_->next_ = c;
+	} else {
+		c->next_ = chunks_;
+		chunks_ = c;
+	}
+	++chunkCount_;
+	reserved_ += size;
+
+	char* p = reinterpret_cast<char*>(c) + header;
+	if (own) {
+		used_ += bytes;
+		return p;
+	}
+	cur_ = p;
+	end_ = reinterpret_cast<char*>(c) + size;
+	return allocate(bytes, align);
+}
+
+void small_string_arena::release()
+{
+	while (chunks_) {
+		chunk* next = chunks_->next_;
+		::operator delete(chunks_);
+		chunks_ = next;
+	}
+	cur_ = 0;
+	end_ = 0;
+	chunkCount_ = 0;
+	reserved_ = 0;
+	used_ = 0;
+}
+
 size_t hash_bytes_def(const void* ptr, size_t len, size_t seed)
 {
 	size_t hash = seed;
@@ -48,6 +98,28 @@ size_t hash_bytes_32(const void* ptr, size_t len, size_t seed)
 	return hash;
 }
 
+namespace {
+
+// load_bytes without the loop, from at most three loads; the loop's branch
+// on the length mispredicts on keys of mixed lengths.
+inline size_t load_tail(const char* p, size_t n)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (n >= 4) {
+		uint32_t lo, hi;
+		memcpy(&lo, p, sizeof(lo));
+		memcpy(&hi, p + n - 4, sizeof(hi));
+		return lo | (static_cast<size_t>(hi) << (8 * (n - 4)));
+	}
+	const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+	return u[0] | (static_cast<size_t>(u[n >> 1]) << (8 * (n >> 1))) | (static_cast<size_t>(u[n - 1]) << (8 * (n - 1)));
+#else
+	return load_bytes(p, static_cast<int>(n));
+#endif
+}
+
+}
+
 size_t hash_bytes_64(const void* ptr, size_t len, size_t seed)
 {
 	static const size_t mul = (((size_t)0xc6a4a793UL) << 32UL) + (size_t)0x5bd1e995UL;
@@ -64,7 +136,7 @@ size_t hash_bytes_64(const void* ptr, size_t len, size_t seed)
 		hash *= mul;
 	}
 	if ((len & 0x7) != 0) {
-		const size_t data = load_bytes(end, len & 0x7);
+		const size_t data = load_tail(end, len & 0x7);
 		hash ^= data;
 		hash *= mul;
 	}
@@ -73,4 +145,19 @@ size_t hash_bytes_64(const void* ptr, size_t len, size_t seed)
 	return hash;
 }
 
+void hash_bytes_batch(const void* const* ptrs, const size_t* lens, size_t n, size_t seed, size_t* out)
+{
+	// Keys are usually scattered over the heap; fetching the ones a few
+	// iterations ahead overlaps their cache misses with hashing.
+	const size_t prefetch_distance = 16;
+	size_t i = 0;
+	for (; i + prefetch_distance < n; ++i) {
+		__builtin_prefetch(ptrs[i + prefetch_distance]);
+		out[i] = hash_bytes(ptrs[i], lens[i], seed);
+	}
+	for (; i != n; ++i) {
+		out[i] = hash_bytes(ptrs[i], lens[i], seed);
+	}
+}
+
 }
\ No newline at end of file
@@ -3,106 +3,507 @@
 
 #include <cstdint>
 #include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
 #include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 namespace ant {
 
+// memcmp for the short runs keys are made of: eight bytes at a time,
+// the first differing word decides once loaded in big-endian order.
+inline int compare_bytes(const char* a, const char* b, size_t n)
+{
+	for (; n >= sizeof(uint64_t); n -= sizeof(uint64_t), a += sizeof(uint64_t), b += sizeof(uint64_t)) {
+		uint64_t x, y;
+		memcpy(&x, a, sizeof(x));
+		memcpy(&y, b, sizeof(y));
+		if (x != y) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			x = __builtin_bswap64(x);
+			y = __builtin_bswap64(y);
+#endif
+			return x < y ? -1 : 1;
+		}
+	}
+	for (; n; --n, ++a, ++b) {
+		if (*a != *b) {
+			return static_cast<unsigned char>(*a) < static_cast<unsigned char>(*b) ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief A non-owning reference to a run of bytes, used as a key without copying it.
+ *
+ * The bytes must outlive the reference and need not be null-terminated.
+ * small_strings convert to it implicitly, and small_string_less,
+ * small_string_hash and small_string_equal compare and hash both alike, so
+ * a key borrowed from a network buffer or a mapped file is looked up in a
+ * container of small_strings without constructing one:
+ *
+ *     ant::linked_map<ant::small_string, int, ant::small_string_less> m;
+ *     auto it = m.find(ant::small_string_ref(buf + off, len));
+ */
+class small_string_ref {
+public:
+	typedef size_t size_type;
+
+public:
+	small_string_ref() : data_(""), size_(0)
+	{
+	}
+
+	small_string_ref(const char* s) : data_(s), size_(strlen(s))
+	{
+	}
+
+	small_string_ref(const char* s, size_type n) : data_(s), size_(n)
+	{
+	}
+
+	small_string_ref(const std::string& s) : data_(s.data()), size_(s.size())
+	{
+	}
+
+#if __cplusplus >= 201703L
+	small_string_ref(std::string_view s) : data_(s.data()), size_(s.size())
+	{
+	}
+
+	operator std::string_view() const noexcept
+	{
+		return std::string_view(data_, size_);
+	}
+#endif
+
+	size_type size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	const char* data() const
+	{
+		return data_;
+	}
+
+	/**
+	 * @return <0, 0 or >0 as *this orders before, equal to or after rhs, in the order of small_string
+	 */
+	int compare(small_string_ref rhs) const
+	{
+		int r = compare_bytes(data_, rhs.data_, size_ < rhs.size_ ? size_ : rhs.size_);
+		if (r != 0) {
+			return r;
+		}
+		return size_ < rhs.size_ ? -1 : (size_ > rhs.size_ ? 1 : 0);
+	}
+
+	/**
+	 * @return hash of the bytes, equal to small_string::hash() of the same bytes
+	 */
+	size_t hash() const;
+
+	friend bool operator==(small_string_ref lhs, small_string_ref rhs)
+	{
+		return lhs.size_ == rhs.size_ && memcmp(lhs.data_, rhs.data_, lhs.size_) == 0;
+	}
+
+	friend bool operator!=(small_string_ref lhs, small_string_ref rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	friend bool operator<(small_string_ref lhs, small_string_ref rhs)
+	{
+		return lhs.compare(rhs) < 0;
+	}
+
+	friend std::ostream& operator<<(std::ostream& out, small_string_ref s)
+	{
+		return out.write(s.data_, s.size_);
+	}
+
+private:
+	const char*	data_;
+	size_type	size_;
+};
+
+/**
+ * @brief A bump allocator for the buffers of bulk-loaded small_strings.
+ *
+ * small_strings built with an arena carve their heap buffers out of large
+ * chunks, so loading a million keys takes a handful of allocations, and
+ * release() frees them all at once:
+ *
+ *     ant::small_string_arena arena;
+ *     ant::linked_map<ant::small_string, int> m;
+ *     for (...) {
+ *         m.emplace(ant::small_string(ant::small_string_ref(p, len), arena), v);
+ *     }
+ *
+ * Such strings don't own their buffers: they must not be used once the
+ * arena is released or destroyed, though destroying them afterwards is
+ * fine. Moving one keeps the buffer in the arena, copying one makes an
+ * ordinary heap copy. Buffers freed by assigning longer contents are only
+ * reclaimed by release(). Not thread-safe.
+ */
+class small_string_arena {
+public:
+	static const size_t default_chunk_size = 1024 * 1024;
+
+public:
+	/**
+	 * @param chunkSize bytes requested from the heap at a time; buffers above a quarter of it get a chunk each
+	 */
+	explicit small_string_arena(size_t chunkSize = default_chunk_size);
+
+	~small_string_arena()
+	{
+		release();
+	}
+
+	/**
+	 * @param align a power of 2 up to 16
+	 * @throw std::bad_alloc
+	 */
+	void* allocate(size_t bytes, size_t align)
+	{
+		char* p = cur_ + (-reinterpret_cast<uintptr_t>(cur_) & (align - 1));
+		if (cur_ && p <= end_ && bytes <= size_t(end_ - p)) {
+			cur_ = p + bytes;
+			used_ += bytes;
+			return p;
+		}
+		return allocate_slow(bytes, align);
+	}
+
+	/**
+	 * @brief Frees every chunk; strings built with the arena must no longer be used.
+	 */
+	void release();
+
+	size_t chunk_count() const
+	{
+		return chunkCount_;
+	}
+
+	/**
+	 * @return bytes of the chunks taken from the heap
+	 */
+	size_t reserved_bytes() const
+	{
+		return reserved_;
+	}
+
+	/**
+	 * @return bytes handed out to strings
+	 */
+	size_t used_bytes() const
+	{
+		return used_;
+	}
+
+private:
+	// Chunk header; the usable bytes follow it, 16-byte aligned.
+	struct chunk {
+		chunk*	next_;
+		size_t	size_;
+	};
+
+	void* allocate_slow(size_t bytes, size_t align);
+
+	small_string_arena(const small_string_arena&);
+	small_string_arena& operator=(const small_string_arena&);
+
+private:
+	chunk*	chunks_;
+	char*	cur_;
+	char*	end_;
+	size_t	chunkSize_;
+	size_t	chunkCount_;
+	size_t	reserved_;
+	size_t	used_;
+};
+
+/**
+ * @brief A compact string for keys.
+ *
+ * Strings of up to inline_capacity bytes are stored inside the object and
+ * never allocate; only longer ones, up to max_length bytes, are copied to
+ * the heap. The object takes 16 bytes either way.
+ *
+ * Heap strings of hash_cache_min_length bytes or more reserve a word in
+ * front of their characters for hash(), which fills it on first use, so
+ * hash containers rehashing or probing with long keys hash each key once.
+ *
+ * Heap buffers can come from a small_string_arena instead of new[] for
+ * key sets loaded in bulk.
+ */
 class small_string {
 public:
 	typedef size_t size_type;
 
+	static const size_type inline_capacity = 15;
+	static const size_type max_length = UINT32_MAX;
+	static const size_type hash_cache_min_length = 64;
+
 public:
 	small_string()
 	{
-		len_ = 0;
-		str_ = 0;
+		init_inline(0);
 	}
 
 	small_string(const small_string& rhs)
 	{
-		construct(rhs.str_, rhs.len_);
+		construct(rhs.c_str(), rhs.size());
 	}
 
 	small_string(const char* s)
 	{
-		auto len = strlen(s);
-		if (len > 255) {
-			len = 255;
-		}
-		construct(s, static_cast<uint8_t>(len));
+		construct(s, strlen(s));
 	}
 
 	small_string(const std::string& s)
 	{
-		auto len = s.size();
-		if (len > 255) {
-			len = 255;
-		}
-		construct(s.c_str(), static_cast<uint8_t>(len));
+		construct(s.c_str(), s.size());
+	}
+
+	/**
+	 * @brief Copies the referenced bytes.
+	 */
+	explicit small_string(small_string_ref s)
+	{
+		construct(s.data(), s.size());
+	}
+
+	/**
+	 * @brief Copies the referenced bytes, into a buffer from arena if they don't fit inline.
+	 */
+	small_string(small_string_ref s, small_string_arena& arena)
+	{
+		construct(s.data(), s.size(), &arena);
+	}
+
+#if __cplusplus >= 201703L
+	explicit small_string(std::string_view s)
+	{
+		construct(s.data(), s.size());
+	}
+#endif
+
+	/**
+	 * @brief Copies n bytes from s, which may contain NULs.
+	 */
+	small_string(const char* s, size_type n)
+	{
+		construct(s, n);
+	}
+
+	/**
+	 * @brief Makes a string of n copies of c.
+	 */
+	small_string(size_type n, char c)
+	{
+		construct(0, n);
+		memset(mutable_data(), c, n);
+	}
+
+	/**
+	 * @brief Takes over the storage of rhs, leaving it empty. Never allocates.
+	 */
+	small_string(small_string&& rhs) noexcept
+	{
+		memcpy(&inline_, &rhs.inline_, sizeof(inline_));
+		rhs.init_inline(0);
 	}
 
 	~small_string()
 	{
-		delete[] str_;
+		release();
 	}
 
 	const small_string& operator=(const small_string& rhs)
 	{
 		if (&rhs != this) {
-			assign(rhs.str_, rhs.len_);
+			assign(rhs.c_str(), rhs.size());
 		}
 		return *this;
 	}
 
 	const small_string& operator=(const std::string& rhs)
 	{
-		auto len = rhs.size();
-		if (len > 255) {
-			len = 255;
-		}
-		assign(rhs.c_str(), static_cast<uint8_t>(len));
+		assign(rhs.c_str(), rhs.size());
 		return *this;
 	}
 
 	const small_string& operator=(const char* rhs)
 	{
-		auto len = strlen(rhs);
-		if (len > 255) {
-			len = 255;
+		assign(rhs, strlen(rhs));
+		return *this;
+	}
+
+	const small_string& operator=(small_string_ref rhs)
+	{
+		assign(rhs.data(), rhs.size());
+		return *this;
+	}
+
+	const small_string& operator=(small_string&& rhs) noexcept
+	{
+		if (&rhs != this) {
+			release();
+			memcpy(&inline_, &rhs.inline_, sizeof(inline_));
+			rhs.init_inline(0);
 		}
-		assign(rhs, static_cast<uint8_t>(len));
 		return *this;
 	}
 
+	/**
+	 * @brief Replaces the contents with n bytes from s.
+	 *
+	 * The current buffer is reused whenever the new contents fit into it,
+	 * so assigning to a string repeatedly allocates only when it grows.
+	 */
+	void assign(const char* s, size_type n)
+	{
+		if (n <= capacity() && (!is_heap() || capacity() - n <= max_slack)) {
+			// s may point into *this, so move the bytes before set_size() terminates them
+			memmove(mutable_data(), s, n);
+			set_size(n);
+			return;
+		}
+		// copy before freeing the buffer s may point into; *this is unchanged if that throws
+		small_string tmp(s, n);
+		swap(tmp);
+	}
+
+	void swap(small_string& rhs) noexcept
+	{
+		inline_rep tmp;
+		memcpy(&tmp, &inline_, sizeof(tmp));
+		memcpy(&inline_, &rhs.inline_, sizeof(tmp));
+		memcpy(&rhs.inline_, &tmp, sizeof(tmp));
+	}
+
+	friend void swap(small_string& lhs, small_string& rhs) noexcept
+	{
+		lhs.swap(rhs);
+	}
+
 	size_type size() const
 	{
-		return len_;
+		return is_heap() ? heap_.size_ : inline_capacity - inline_tag();
 	}
 
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * @return bytes the string can hold without reallocating
+	 */
+	size_type capacity() const
+	{
+		return is_heap() ? heap_.size_ + heap_slack() : inline_capacity;
+	}
+
+	/**
+	 * @return the null-terminated characters, never null
+	 */
 	const char* c_str() const
 	{
-		return str_;
+		return is_heap() ? heap_.ptr_ : inline_.buf_;
+	}
+
+	const char* data() const
+	{
+		return c_str();
+	}
+
+	operator small_string_ref() const
+	{
+		return small_string_ref(c_str(), size());
+	}
+
+#if __cplusplus >= 201703L
+	operator std::string_view() const noexcept
+	{
+		return std::string_view(c_str(), size());
 	}
+#endif
+
+	/**
+	 * @return <0, 0 or >0 as *this orders before, equal to or after rhs
+	 *
+	 * Bytes are compared as unsigned char, so embedded NULs are fine and the
+	 * order matches std::string; a string orders before any longer string it
+	 * is a prefix of.
+	 */
+	int compare(const small_string& rhs) const
+	{
+		const size_type lsize = size();
+		const size_type rsize = rhs.size();
+		int r = compare_bytes(c_str(), rhs.c_str(), lsize < rsize ? lsize : rsize);
+		if (r != 0) {
+			return r;
+		}
+		return lsize < rsize ? -1 : (lsize > rsize ? 1 : 0);
+	}
+
+	/**
+	 * @return hash of the characters, the value of std::hash<small_string>
+	 *
+	 * Cached for strings with a hash slot. Concurrent calls on the same
+	 * const string are safe; they may both compute the hash.
+	 */
+	size_t hash() const;
 
 public:
 	friend bool operator==(const small_string& lhs, const small_string& rhs)
 	{
-		return (&lhs == &rhs) || ((lhs.len_ == rhs.len_) && ((lhs.len_ == 0) || (strcmp(lhs.str_, rhs.str_) == 0)));
+		const size_type n = lhs.size();
+		return n == rhs.size() && memcmp(lhs.c_str(), rhs.c_str(), n) == 0;
+	}
+
+	friend bool operator!=(const small_string& lhs, const small_string& rhs)
+	{
+		return !(lhs == rhs);
 	}
 
 	friend bool operator<(const small_string& lhs, const small_string& rhs)
 	{
-		return &lhs != &rhs && rhs.len_ != 0 && (lhs.len_ == 0 || strcmp(lhs.str_, rhs.str_) < 0);
+		return lhs.compare(rhs) < 0;
 	}
 
 	friend bool operator>(const small_string& lhs, const small_string& rhs)
 	{
-		return &lhs != &rhs && lhs.len_ != 0 && (rhs.len_ == 0 || strcmp(lhs.str_, rhs.str_) > 0);
+		return lhs.compare(rhs) > 0;
+	}
+
+	friend bool operator<=(const small_string& lhs, const small_string& rhs)
+	{
+		return lhs.compare(rhs) <= 0;
+	}
+
+	friend bool operator>=(const small_string& lhs, const small_string& rhs)
+	{
+		return lhs.compare(rhs) >= 0;
 	}
 
 	friend std::ostream& operator<<(std::ostream& out, const small_string& s)
 	{
-		out << ((s.len_ > 0) ? s.str_ : "");
+		out.write(s.c_str(), s.size());
 		return out;
 	}
 
@@ -114,43 +515,144 @@ public:
 		return in;
 	}
 
+	/**
+	 * @return bytes of the heap buffer owned by s, used by memory_usage() of the linked containers
+	 */
+	friend size_t heap_bytes(const small_string& s)
+	{
+		if (!s.is_heap() || (s.inline_tag() & arena_flag)) {
+			return 0; // arena buffers are accounted by the arena
+		}
+		return s.capacity() + 1 + (s.has_hash_slot() ? sizeof(size_t) : 0);
+	}
+
 private:
-	inline void construct(const char* s, uint8_t len)
-	{
-		if (len > 0) {
-			len_ = len;
-			size_t n = len_ + 1;
-			str_ = new char[n];
-			memcpy(str_, s, len_);
-			str_[len_] = '\0';
+	// Heap tags; inline tags are at most inline_capacity.
+	static const uint8_t heap_tag = 0x80;
+	static const uint8_t hash_slot_flag = 0x01;		// a hash slot precedes the characters
+	static const uint8_t arena_flag = 0x02;			// the buffer belongs to a small_string_arena
+
+	// Heap strings keep capacity() - size() in the three spare bytes of
+	// heap_rep, so a shrunk buffer can be reused without growing the object.
+	static const size_type max_slack = 0xFFFFFF;
+
+	size_type heap_slack() const
+	{
+		return static_cast<uint8_t>(heap_.slack_[0]) | (static_cast<uint8_t>(heap_.slack_[1]) << 8)
+				| (static_cast<size_type>(static_cast<uint8_t>(heap_.slack_[2])) << 16);
+	}
+
+	void set_heap_slack(size_type slack)
+	{
+		heap_.slack_[0] = static_cast<char>(slack);
+		heap_.slack_[1] = static_cast<char>(slack >> 8);
+		heap_.slack_[2] = static_cast<char>(slack >> 16);
+	}
+
+	char* mutable_data()
+	{
+		return is_heap() ? heap_.ptr_ : inline_.buf_;
+	}
+
+	bool has_hash_slot() const
+	{
+		return (inline_tag() & (heap_tag | hash_slot_flag)) == (heap_tag | hash_slot_flag);
+	}
+
+	// 0 until hash() caches the hash; a hash that happens to be 0 is never cached.
+	size_t* hash_slot() const
+	{
+		return reinterpret_cast<size_t*>(heap_.ptr_) - 1;
+	}
+
+	// Sets the size of a string that has room for len bytes and terminates it.
+	void set_size(size_type len)
+	{
+		if (is_heap()) {
+			set_heap_slack(heap_.size_ + heap_slack() - len);
+			heap_.size_ = static_cast<uint32_t>(len);
+			heap_.ptr_[len] = '\0';
+			if (has_hash_slot()) {
+				*hash_slot() = 0;
+			}
 		} else {
-			len_ = 0;
-			str_ = 0;
+			init_inline(len);
 		}
 	}
 
-	void assign(const char* s, uint8_t len)
+	void release()
 	{
-		if (len != len_) {
-			delete str_;
-			str_ = 0;
+		if (is_heap() && !(inline_tag() & arena_flag)) {
+			delete[] (has_hash_slot() ? heap_.ptr_ - sizeof(size_t) : heap_.ptr_);
 		}
-		if (len > 0) {
-			size_t n = len + 1;
-			if (!str_) {
-				str_ = new char[n];
+	}
+
+	uint8_t inline_tag() const
+	{
+		return static_cast<uint8_t>(inline_.buf_[inline_capacity]);
+	}
+
+	bool is_heap() const
+	{
+		return inline_tag() >= heap_tag;
+	}
+
+	void init_inline(size_type len)
+	{
+		inline_.buf_[len] = '\0';
+		inline_.buf_[inline_capacity] = static_cast<char>(inline_capacity - len);
+	}
+
+	// Sets up storage for len bytes and copies s into it unless s is null.
+	// Heap buffers come from arena if one is given.
+	inline void construct(const char* s, size_type len, small_string_arena* arena = 0)
+	{
+		if (len > max_length) {
+			throw std::length_error("small_string: string too long");
+		}
+		if (len <= inline_capacity) {
+			if (s) {
+				memcpy(inline_.buf_, s, len);
 			}
-			len_ = len;
-			memcpy(str_, s, len_);
-			str_[len_] = '\0';
+			init_inline(len);
 		} else {
-			len_ = 0;
+			const size_type slot = len >= hash_cache_min_length ? sizeof(size_t) : 0;
+			const size_type bytes = slot + len + 1;
+			char* block = arena ? static_cast<char*>(arena->allocate(bytes, slot ? sizeof(size_t) : 1))
+					: new char[bytes];
+			heap_.ptr_ = block + slot;
+			heap_.tag_ = static_cast<uint8_t>(heap_tag | (slot ? hash_slot_flag : 0) | (arena ? arena_flag : 0));
+			if (slot) {
+				*hash_slot() = 0;
+			}
+			if (s) {
+				memcpy(heap_.ptr_, s, len);
+			}
+			heap_.ptr_[len] = '\0';
+			heap_.size_ = static_cast<uint32_t>(len);
+			set_heap_slack(0);
 		}
 	}
 
 private:
-	uint8_t		len_;
-	char*		str_;
+	// Both representations end with the tag byte.  Inline, it holds
+	// inline_capacity - size(), which is 0 and so doubles as the terminator
+	// when the buffer is full; heap strings have heap_tag there, ORed with flags.
+	struct inline_rep {
+		char		buf_[inline_capacity + 1];
+	};
+
+	struct heap_rep {
+		char*		ptr_;
+		uint32_t	size_;
+		char		slack_[inline_capacity - sizeof(char*) - sizeof(uint32_t)];
+		uint8_t		tag_;
+	};
+
+	union {
+		inline_rep	inline_;
+		heap_rep	heap_;
+	};
 };
 
 inline size_t unaligned_load(const char* p)
@@ -180,6 +682,29 @@ size_t hash_bytes_def(const void* ptr, size_t len, size_t seed);
 size_t hash_bytes_32(const void* ptr, size_t len, size_t seed);
 size_t hash_bytes_64(const void* ptr, size_t len, size_t seed);
 
+/**
+ * @brief Sets out[i] to hash_bytes(ptrs[i], lens[i], seed) for each of the n keys.
+ *
+ * Prefetches the keys a few iterations ahead, which pays off on large
+ * batches of keys scattered over the heap, as when partitioning a key set
+ * into shards.
+ */
+void hash_bytes_batch(const void* const* ptrs, const size_t* lens, size_t n, size_t seed, size_t* out);
+
+/**
+ * @brief A faster hash for long keys, from the wyhash and XXH3 designs.
+ *
+ * Long keys are hashed with SSE2, AVX2 or NEON, whichever the CPU running
+ * the program supports; the value doesn't depend on the kernel picked, nor
+ * on the byte order, but differs from hash_bytes().
+ */
+size_t hash_bytes_fast(const void* ptr, size_t len, size_t seed);
+
+/**
+ * @return name of the kernel hash_bytes_fast() uses on this CPU: "avx2", "sse2", "neon" or "scalar"
+ */
+const char* hash_bytes_fast_kernel();
+
 inline size_t hash_bytes(const void* ptr, size_t len, size_t seed)
 {
 	auto sz = sizeof(size_t);
@@ -193,6 +718,84 @@ inline size_t hash_bytes(const void* ptr, size_t len, size_t seed)
 	}
 }
 
+inline size_t small_string_ref::hash() const
+{
+	return hash_bytes(data_, size_, 0xc70f6907UL);
+}
+
+inline size_t small_string::hash() const
+{
+	if (!has_hash_slot()) {
+		return hash_bytes(c_str(), size(), 0xc70f6907UL);
+	}
+	size_t h = __atomic_load_n(hash_slot(), __ATOMIC_RELAXED);
+	if (h == 0) {
+		h = hash_bytes(heap_.ptr_, heap_.size_, 0xc70f6907UL);
+		__atomic_store_n(hash_slot(), h, __ATOMIC_RELAXED);
+	}
+	return h;
+}
+
+/**
+ * @brief Transparent ordering of small_strings and anything convertible to small_string_ref.
+ *
+ * As the comparison object of a linked_map or linked_set it enables find(),
+ * count() and the bound lookups with a small_string_ref, a std::string or a
+ * string literal without constructing a small_string key.
+ */
+struct small_string_less {
+	typedef void is_transparent;
+
+	bool operator()(small_string_ref lhs, small_string_ref rhs) const
+	{
+		return lhs.compare(rhs) < 0;
+	}
+
+	int compare(small_string_ref lhs, small_string_ref rhs) const
+	{
+		return lhs.compare(rhs);
+	}
+};
+
+/**
+ * @brief Transparent hash for unordered containers keyed by small_string.
+ *
+ * Heterogeneous lookup in the std unordered containers needs C++20 and
+ * small_string_equal alongside.
+ */
+struct small_string_hash {
+	typedef void is_transparent;
+
+	size_t operator()(const small_string& s) const
+	{
+		return s.hash(); // cached for long strings
+	}
+
+	size_t operator()(small_string_ref s) const
+	{
+		return s.hash();
+	}
+
+	size_t operator()(const char* s) const
+	{
+		return small_string_ref(s).hash();
+	}
+
+	size_t operator()(const std::string& s) const
+	{
+		return small_string_ref(s).hash();
+	}
+};
+
+struct small_string_equal {
+	typedef void is_transparent;
+
+	bool operator()(small_string_ref lhs, small_string_ref rhs) const
+	{
+		return lhs == rhs;
+	}
+};
+
 }
 
 namespace std {
@@ -201,7 +804,15 @@ template<>
 struct hash<ant::small_string> {
 	size_t operator()(const ant::small_string& s) const
 	{
-		return ant::hash_bytes(s.c_str(), s.size(), 0xc70f6907UL);
+		return s.hash();
+	}
+};
+
+template<>
+struct hash<ant::small_string_ref> {
+	size_t operator()(ant::small_string_ref s) const
+	{
+		return s.hash();
 	}
 };
 